@@ -0,0 +1,480 @@
+// seqt_bench [--cpu] [--quick] [--corpus file] [--out results.json]
+//
+// measures read() throughput, what the main primitives cost and how both
+// scale with _max_sequences_tracked and the size of the alphabet.  the
+// results go out as JSON so runs from different builds can be compared.
+
+#include "seqt.hpp"
+#include "mapped_file.hpp"
+#include "utf8_input.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef SEQT_EXAMPLES_DIR
+#define SEQT_EXAMPLES_DIR "examples"
+#endif
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct options {
+    seqt::backend backend = seqt::backend::opencl;
+    bool quick = false;
+    std::string corpus = SEQT_EXAMPLES_DIR "/alice.txt";
+    std::string out;
+};
+
+// one JSON object, fields in the order they were set
+class record {
+public:
+    record & set(std::string const & key, std::string const & value) {
+        field(key) += quoted(value);
+        return *this;
+    }
+
+    record & set(std::string const & key, const char * value) {
+        return set(key, std::string(value));
+    }
+
+    record & set(std::string const & key, double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+        field(key) += buffer;
+        return *this;
+    }
+
+    record & set(std::string const & key, long value) {
+        field(key) += std::to_string(value);
+        return *this;
+    }
+
+    std::string str() const { return "{" + _fields + "}"; }
+
+private:
+    std::string & field(std::string const & key) {
+        if(!_fields.empty())
+            _fields += ", ";
+        return _fields += quoted(key) + ": ";
+    }
+
+    static std::string quoted(std::string const & s) {
+        std::string q = "\"";
+        for(char c : s) {
+            if(c == '"' || c == '\\')
+                q += '\\';
+            if((unsigned char)c >= 0x20)
+                q += c;
+        }
+        return q + "\"";
+    }
+
+    std::string _fields;
+};
+
+std::string array(std::vector<record> const & records) {
+    std::string s = "[";
+    for(size_t i = 0; i < records.size(); i++)
+        s += (i ? ",\n    " : "\n    ") + records[i].str();
+    return s + (records.empty() ? "]" : "\n  ]");
+}
+
+// corpora, the synthetic ones are seeded so every run reads the same symbols
+
+std::vector<wchar_t> text_corpus(std::string const & path, size_t limit) {
+    mapped_file file(path);
+    utf8_decoder decoder(file.data(), file.data() + file.size());
+
+    std::vector<wchar_t> text(file.size());
+    text.resize(decoder.decode(text.data(), text.size()));
+    if(text.size() > limit)
+        text.resize(limit);
+    return text;
+}
+
+// nothing to find, every pair is a candidate about as often as any other
+std::vector<unsigned char> uniform_bytes(size_t length, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<unsigned char> bytes(length);
+    for(auto & b : bytes)
+        b = rng() & 0xFF;
+    return bytes;
+}
+
+// every symbol is usually followed by one of three others, so there is structure to find
+std::vector<uint32_t> markov_tokens(size_t length, uint32_t alphabet_size, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> coin(0, 1);
+
+    std::vector<std::array<uint32_t, 3>> successors(alphabet_size);
+    for(auto & s : successors)
+        for(auto & next : s)
+            next = rng() % alphabet_size;
+
+    std::vector<uint32_t> tokens(length);
+    uint32_t symbol = 0;
+    for(auto & t : tokens) {
+        symbol = coin(rng) < .9 ? successors[symbol][rng() % 3] : rng() % alphabet_size;
+        t = symbol;
+    }
+    return tokens;
+}
+
+// the fibonacci word (a, ab, aba, abaab, ...), about as repetitive as input gets
+std::vector<uint32_t> fibonacci_tokens(size_t length) {
+    std::vector<uint32_t> a = { 0 }, b = { 0, 1 };
+    while(b.size() < length) {
+        std::vector<uint32_t> c = b;
+        c.insert(c.end(), a.begin(), a.end());
+        a.swap(b);
+        b.swap(c);
+    }
+    b.resize(length);
+    return b;
+}
+
+struct timing {
+    double mean_us;
+    double median_us;
+    double min_us;
+};
+
+// the primitives of whichever engine is benchmarked, called the way read() calls them
+class engine {
+public:
+    engine(options const & o, alphabet::kind symbols, long max_sequences_tracked) :
+        _s(o.backend, symbols),
+        _cpu(_s._cpu.get()),
+        _cl(_s._opencl.get())
+    {
+        if(_cpu) {
+            _cpu->_max_sequences_tracked = max_sequences_tracked;
+        } else {
+            _cl->_max_sequences_tracked = max_sequences_tracked;
+            _device = std::make_unique<device_scratch>(_cl->_context);
+        }
+    }
+
+    template<typename Symbol>
+    double read(std::vector<Symbol> const & symbols) {
+        auto start = clock_type::now();
+        _s.read(symbols.data(), symbols.size());
+        sync();
+        return std::chrono::duration<double>(clock_type::now() - start).count();
+    }
+
+    void sync() {
+        if(_cl)
+            _cl->_queue.finish();
+    }
+
+    long total() const { return _cpu ? _cpu->_total : _cl->_total; }
+
+    // time read() spent blocked on the device and how many times, the host engine never blocks
+    double stall_ms() const { return _cpu ? 0 : std::chrono::duration<double, std::milli>(_cl->_stall_time).count(); }
+    long stall_count() const { return _cpu ? 0 : _cl->_stall_count; }
+
+    // everything on one in-order queue, the way read() ran before it had a side queue
+    void in_order() {
+        if(_cl)
+            _cl->_overlap = false;
+    }
+
+    // everything that completed on the last symbol read
+    void pack() {
+        if(_cpu) {
+            long position = _cpu->_position;
+            _cpu_current = _cpu->pack(_cpu->_last_completed, [=](long x) { return x == position; });
+        } else {
+            _cl->pack(_cl->_last_completed, pack_if::equal(_cl->_position), _device->current);
+        }
+    }
+
+    void find_nexts_by_length() {
+        if(_cpu)
+            _cpu_found = _cpu->find_nexts_by_length(_cpu_current);
+        else
+            _cl->find_nexts_by_length(_device->current, _device->found);
+    }
+
+    void mark_exists() {
+        if(_cpu) {
+            _cpu_scratch.resize(_cpu_found.size());
+            _cpu->mark_exists(_cpu_found, _cpu_scratch);
+        } else if(_device->found.size() > 0) {
+            _device->scratch.resize(_device->found.size(), _cl->_queue);
+            _cl->mark_exists(_device->found, _device->scratch);
+        }
+    }
+
+    void calculate_stats() {
+        if(_cpu)
+            _cpu->calculate_stats();
+        else
+            _cl->calculate_stats();
+    }
+
+    void remove_least_significant() {
+        if(_cpu)
+            _cpu->remove_least_significant(total() / 2);
+        else
+            _cl->remove_least_significant(total() / 2);
+    }
+
+    // keeps every sequence, so the table is the same afterwards
+    void recreate_from_map() {
+        if(_cpu) {
+            std::vector<long> index(total());
+            std::iota(index.begin(), index.end(), 0);
+            _cpu->recreate_from_map(index);
+        } else {
+            vector<index_t> index(total(), _cl->_context);
+            boost::compute::iota(index.begin(), index.end(), 0, _cl->_queue);
+            _cl->recreate_from_map(index);
+        }
+    }
+
+    void save(std::string const & path) { _s.save(path); }
+    void load(std::string const & path) { _s.load(path); }
+
+    std::string device() const { return _cpu ? "host" : _cl->_device.name(); }
+
+    // the host engine has nothing to dispatch
+    std::map<std::string, dispatcher::primitive> dispatched() const {
+        return _cpu ? std::map<std::string, dispatcher::primitive>() : _cl->_dispatch._primitives;
+    }
+
+    // run f `iterations` times after an untimed setup() each time
+    timing measure(long iterations, std::function<void()> f, std::function<void()> setup = nullptr) {
+        std::vector<double> us;
+
+        for(long i = 0; i < iterations; i++) {
+            if(setup)
+                setup();
+            sync();
+
+            auto start = clock_type::now();
+            f();
+            sync();
+            us.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - start).count());
+        }
+
+        std::sort(us.begin(), us.end());
+
+        timing t;
+        t.mean_us = 0;
+        for(double u : us)
+            t.mean_us += u / us.size();
+        t.median_us = us[us.size() / 2];
+        t.min_us = us.front();
+        return t;
+    }
+
+private:
+    seqt _s;
+    seqt_cpu * _cpu;    // whichever of these _s made, the other is null
+    seqt_opencl * _cl;
+
+    // only made for the device engine, so the host one runs without a device
+    struct device_scratch {
+        vector<index_t> current;
+        vector<index2_t> found;
+        vector<index_t> scratch;
+
+        explicit device_scratch(context const & c) : current(0, c), found(0, c), scratch(0, c) { }
+    };
+    std::unique_ptr<device_scratch> _device;
+
+    std::vector<long> _cpu_current;
+    std::vector<long2_> _cpu_found;
+    std::vector<long> _cpu_scratch;
+};
+
+record timed(std::string const & name, long table_size, long iterations, timing const & t) {
+    record r;
+    r.set("name", name)
+     .set("table_size", table_size)
+     .set("iterations", iterations)
+     .set("mean_us", t.mean_us)
+     .set("median_us", t.median_us)
+     .set("min_us", t.min_us);
+    return r;
+}
+
+template<typename Symbol>
+record ingest(options const & o, std::string const & corpus, alphabet::kind symbols, std::vector<Symbol> const & data) {
+    engine e(o, symbols, 1000);
+    double seconds = e.read(data);
+
+    // and again with everything in order on one queue, to see what the side queue saves.
+    // the host engine never stalls, so there is nothing to compare
+    double in_order_seconds = 0, in_order_stall_ms = 0;
+    long in_order_stall_count = 0;
+    if(o.backend == seqt::backend::opencl) {
+        engine serial(o, symbols, 1000);
+        serial.in_order();
+        in_order_seconds = serial.read(data);
+        in_order_stall_ms = serial.stall_ms();
+        in_order_stall_count = serial.stall_count();
+    }
+
+    long host_calls = 0, device_calls = 0;
+    for(auto const & p : e.dispatched()) {
+        host_calls += p.second.host_calls;
+        device_calls += p.second.device_calls;
+    }
+
+    record r;
+    r.set("corpus", corpus)
+     .set("alphabet", alphabet::name(symbols))
+     .set("symbols", (long)data.size())
+     .set("seconds", seconds)
+     .set("symbols_per_second", data.size() / seconds)
+     .set("table_size", e.total())
+     .set("host_calls", host_calls)
+     .set("device_calls", device_calls)
+     .set("stall_ms", e.stall_ms())
+     .set("stall_count", e.stall_count())
+     .set("in_order_seconds", in_order_seconds)
+     .set("in_order_stall_ms", in_order_stall_ms)
+     .set("in_order_stall_count", in_order_stall_count);
+    return r;
+}
+
+} // namespace
+
+int main(int ac, char ** av) {
+    options o;
+
+    for(int i = 1; i < ac; i++) {
+        std::string option = av[i];
+
+        if(option == "--cpu") {
+            o.backend = seqt::backend::cpu;
+        } else if(option == "--quick") {
+            o.quick = true;
+        } else if((option == "--corpus" || option == "--out") && i + 1 < ac) {
+            (option == "--corpus" ? o.corpus : o.out) = av[++i];
+        } else {
+            std::cerr << "usage: seqt_bench [--cpu] [--quick] [--corpus file] [--out results.json]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const size_t synthetic_length = o.quick ? 10000 : 100000;
+    const size_t scaling_length = o.quick ? 5000 : 50000;
+    const long iterations = o.quick ? 10 : 100;
+    const long prune_iterations = o.quick ? 3 : 20;
+
+    std::vector<wchar_t> text = text_corpus(o.corpus, o.quick ? 20000 : SIZE_MAX);
+
+    // read() throughput on each kind of input
+    std::cerr << "ingest" << std::endl;
+    std::vector<record> ingested;
+    ingested.push_back(ingest(o, std::filesystem::path(o.corpus).filename().string(), alphabet::kind::code_points, text));
+    ingested.push_back(ingest(o, "uniform-bytes", alphabet::kind::bytes, uniform_bytes(synthetic_length, 1)));
+    ingested.push_back(ingest(o, "markov-64", alphabet::kind::tokens, markov_tokens(synthetic_length, 64, 2)));
+    ingested.push_back(ingest(o, "fibonacci", alphabet::kind::tokens, fibonacci_tokens(synthetic_length)));
+
+    // each primitive on the table left by the text corpus
+    std::cerr << "primitives" << std::endl;
+    std::vector<record> primitives;
+    std::vector<record> dispatched;
+    std::string device;
+    {
+        engine e(o, alphabet::kind::code_points, 1000);
+        e.read(text);
+        device = e.device();
+
+        // where read() ran its primitives, and the thresholds that decided it
+        for(auto const & p : e.dispatched()) {
+            record r;
+            r.set("name", p.first)
+             .set("threshold", p.second.threshold)
+             .set("host_calls", p.second.host_calls)
+             .set("device_calls", p.second.device_calls)
+             .set("host_elements", p.second.host_elements)
+             .set("device_elements", p.second.device_elements);
+            dispatched.push_back(r);
+        }
+
+        long size = e.total();
+        std::string snapshot = (std::filesystem::temp_directory_path() / "seqt_bench.snapshot").string();
+        e.save(snapshot);
+
+        primitives.push_back(timed("pack", size, iterations, e.measure(iterations, [&] { e.pack(); })));
+        primitives.push_back(timed("find_nexts_by_length", size, iterations,
+            e.measure(iterations, [&] { e.find_nexts_by_length(); }, [&] { e.pack(); })));
+        primitives.push_back(timed("mark_exists", size, iterations, e.measure(iterations, [&] { e.mark_exists(); })));
+        primitives.push_back(timed("calculate_stats", size, iterations, e.measure(iterations, [&] { e.calculate_stats(); })));
+        primitives.push_back(timed("recreate_from_map", size, iterations, e.measure(iterations, [&] { e.recreate_from_map(); })));
+        primitives.push_back(timed("remove_least_significant", size, prune_iterations,
+            e.measure(prune_iterations, [&] { e.remove_least_significant(); }, [&] { e.load(snapshot); })));
+
+        std::error_code ec;
+        std::filesystem::remove(snapshot, ec);
+    }
+
+    // how throughput and the per character primitives grow with the table and the alphabet
+    std::cerr << "scaling" << std::endl;
+    std::vector<record> scaling;
+    std::vector<long> table_sizes = o.quick ? std::vector<long>{ 250, 1000 } : std::vector<long>{ 250, 1000, 4000 };
+    for(long max_sequences : table_sizes) {
+        for(uint32_t alphabet_size : { 4u, 64u, 1024u }) {
+            engine e(o, alphabet::kind::tokens, max_sequences);
+            std::vector<uint32_t> tokens = markov_tokens(scaling_length, alphabet_size, 3);
+            double seconds = e.read(tokens);
+
+            timing stats = e.measure(iterations, [&] { e.calculate_stats(); });
+            e.pack();
+            timing nexts = e.measure(iterations, [&] { e.find_nexts_by_length(); }, [&] { e.pack(); });
+
+            record r;
+            r.set("max_sequences_tracked", max_sequences)
+             .set("alphabet_size", (long)alphabet_size)
+             .set("symbols", (long)tokens.size())
+             .set("symbols_per_second", tokens.size() / seconds)
+             .set("table_size", e.total())
+             .set("calculate_stats_us", stats.mean_us)
+             .set("find_nexts_by_length_us", nexts.mean_us);
+            scaling.push_back(r);
+        }
+    }
+
+    record run;
+    run.set("backend", o.backend == seqt::backend::cpu ? "cpu" : "opencl")
+       .set("device", device)
+       .set("index_bits", (long)(8 * sizeof(index_t)))
+       .set("quick", (long)o.quick);
+
+    std::string json = "{\n  \"run\": " + run.str() +
+        ",\n  \"ingest\": " + array(ingested) +
+        ",\n  \"primitives\": " + array(primitives) +
+        ",\n  \"dispatch\": " + array(dispatched) +
+        ",\n  \"scaling\": " + array(scaling) + "\n}\n";
+
+    if(o.out.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream f(o.out);
+        f << json;
+        if(!f) {
+            std::cerr << "can't write " << o.out << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
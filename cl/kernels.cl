@@ -1,11 +1,112 @@
+// the host builds this with -DSEQT_INDEX32 when its columns hold 32 bit
+// indices, see include/index_type.hpp
+#ifdef SEQT_INDEX32
+typedef int index_t;
+typedef int2 index2_t;
+#else
+typedef long index_t;
+typedef long2 index2_t;
+#endif
+
+
+// a specialized build (see seqt_opencl::specialize) fixes these, so the compiler
+// can fold them in instead of reading them from the kernel arguments
+#ifdef SEQT_SIGMA
+#define SIGMA(sigma) SEQT_SIGMA
+#else
+#define SIGMA(sigma) (sigma)
+#endif
+
+#ifdef SEQT_MIN_COUNT
+#define MIN_COUNT(min_count) ((index_t)SEQT_MIN_COUNT)
+#else
+#define MIN_COUNT(min_count) (min_count)
+#endif
+
+bool greater_equal(index2_t x, index2_t y) {
+    if(x.s0 > y.s0)
+        return true;
+    if(x.s0 < y.s0)
+        return false;
+    if(x.s1 >= y.s1)
+        return true;
+
+    return false;
+}
+
+bool equal(index2_t x, index2_t y) {
+    return x.s0 == y.s0 && x.s1 == y.s1;
+}
+
+#ifdef SEQT_SEARCH_STEPS
+
+// nothing searched is longer than the table, which a specialized build knows
+// takes at most SEQT_SEARCH_STEPS halvings, so the searches are a fixed number
+// of steps with nothing to branch on but the loop the compiler unrolls
+
+// index of first element in sorted that is >= target
+index_t lower_bound(index_t target, global index_t * sorted, index_t length) {
+    if(length == 0)
+        return 0;
+
+    index_t base = 0;
+    index_t n = length;
+
+    #pragma unroll
+    for(int step = 0; step < SEQT_SEARCH_STEPS; step++) {
+        index_t half = n / 2;
+        base = n > 1 && sorted[base + half] < target ? base + half : base;
+        n -= half;
+    }
+
+    return base + (sorted[base] < target);
+}
+
+// index of first element in sorted that is >= target
+index_t lower_bound2(index2_t target, global index2_t * sorted, index_t length) {
+    if(length == 0)
+        return 0;
+
+    index_t base = 0;
+    index_t n = length;
+
+    #pragma unroll
+    for(int step = 0; step < SEQT_SEARCH_STEPS; step++) {
+        index_t half = n / 2;
+        base = n > 1 && !greater_equal(sorted[base + half], target) ? base + half : base;
+        n -= half;
+    }
+
+    return base + !greater_equal(sorted[base], target);
+}
+
+// index of first element in sorted that is > target
+index_t upper_bound(index_t target, global index_t * sorted, index_t length) {
+    if(length == 0)
+        return 0;
+
+    index_t base = 0;
+    index_t n = length;
+
+    #pragma unroll
+    for(int step = 0; step < SEQT_SEARCH_STEPS; step++) {
+        index_t half = n / 2;
+        base = n > 1 && sorted[base + half] <= target ? base + half : base;
+        n -= half;
+    }
+
+    return base + (sorted[base] <= target);
+}
+
+#else
 
 // index of first element in sorted that is >= target
-long lower_bound(long target, global long * sorted, long length) {
-    long low = 0;
-    long high = length - 1;
+index_t lower_bound(index_t target, global index_t * sorted, index_t length) {
+    index_t low = 0;
+    index_t high = length - 1;
 
     while(low <= high) {
-        long i = (low + high) / 2;
+        index_t i = (low + high) / 2;
 
         if(sorted[i] >= target) 
             high = i - 1;
@@ -17,28 +118,12 @@ long lower_bound(long target, global long * sorted, long length) {
 }
 
 // index of first element in sorted that is >= target
-
-bool greater_equal(long2 x, long2 y) {
-    if(x.s0 > y.s0)
-        return true;
-    if(x.s0 < y.s0)
-        return false;
-    if(x.s1 >= y.s1)
-        return true;
-
-    return false;
-}
-
-bool equal(long2 x, long2 y) {
-    return x.s0 == y.s0 && x.s1 == y.s1;
-}
-
-long lower_bound2(long2 target, global long2 * sorted, long length) {
-    long low = 0;
-    long high = length - 1;
+index_t lower_bound2(index2_t target, global index2_t * sorted, index_t length) {
+    index_t low = 0;
+    index_t high = length - 1;
 
     while(low <= high) {
-        long i = (low + high) / 2;
+        index_t i = (low + high) / 2;
 
         if(greater_equal(sorted[i], target))
             high = i - 1;
@@ -50,12 +135,12 @@ long lower_bound2(long2 target, global long2 * sorted, long length) {
 }
 
 // index of first element in sorted that is > target
-long upper_bound(long target, global long * sorted, long length) {
-    long low = 0;
-    long high = length;
+index_t upper_bound(index_t target, global index_t * sorted, index_t length) {
+    index_t low = 0;
+    index_t high = length;
 
     while(low < high) {
-        long i = (low + high) / 2;
+        index_t i = (low + high) / 2;
 
         if(target >= sorted[i]) 
             low = i + 1;
@@ -66,60 +151,153 @@ long upper_bound(long target, global long * sorted, long length) {
     return low;
 }
 
+#endif // SEQT_SEARCH_STEPS
+
+// how significant sequence i is when characters_read characters have been read
+float sequence_stats(
+    index_t i,
+    global index2_t * seqs,
+    global index2_t * initial_seq_counts,
+    global index_t * counts,
+    global index_t * initial_characters_read,
+    global index_t * lengths,
+    index_t characters_read,
+    float * expected_count,
+    float * stddev_count
+) {
+    // how many a's and b's have we seen since we started tracking ab?
+    index_t a = counts[seqs[i].s0] - initial_seq_counts[i].s0;
+    index_t b = counts[seqs[i].s1] - initial_seq_counts[i].s1;
+
+    if(seqs[i].s0 == 0 || seqs[i].s1 == 0 || a == 0 || b == 0) {
+        // this is either an atom which is as significant as it's count, or it's a newly initialized sequence
+        *stddev_count = 1;
+        *expected_count = 0;
+        return (float)counts[i];
+    } 
+
+    index_t a_len = lengths[seqs[i].s0];
+    index_t b_len = lengths[seqs[i].s1];
+    index_t min_initial = min(initial_characters_read[seqs[i].s0], initial_characters_read[seqs[i].s1]);
+    float characters_since = (float)(characters_read - min_initial);
+
+    // characters since a was first spotted minus it's own characters
+    // we subtract one from the overall count because we start initial_characters after the first occurance
+    float characters_since_a = (float)(characters_read - initial_characters_read[seqs[i].s0] - a_len * (a - 1));
+
+    // characters since b was first completed minus it's own characters
+    float characters_since_b = (float)(characters_read - initial_characters_read[seqs[i].s1] - b_len * (b - 1));
+
+    // probability that at a given location what follows is a
+    float pa = characters_since_a == 0 ? 1e10 : (float)a / characters_since_a; // As/chars
+    // probability that at the given location what is behind is b
+    float pb = characters_since_b == 0 ? 1e10 : (float)b / characters_since_b; // Bs/chars
+    // probability that we are right between a sequence of ab
+    float pab = pa * pb; // As*Bs/chars^2
+
+
+
+    // probability that any particular location is between a and b
+    *expected_count = (characters_since - b_len) * pab; // As * Bs / chars
+
+    if(characters_since - b_len == 0) {
+        *stddev_count = 1;
+        return (float)counts[i];
+    }
+
+    float variation = (characters_since - b_len) * pab * (1. - pab); // As^2 * Bs^2 / chars^3
+
+    *stddev_count = sqrt(variation);
+
+    return ((float)counts[i] - *expected_count) / *stddev_count;
+}
+
+// are both halves of candidate s significant enough to make it a sequence?
+bool is_significant(
+    index2_t s,
+    global index2_t * seqs,
+    global index2_t * initial_seq_counts,
+    global index_t * counts,
+    global index_t * initial_characters_read,
+    global index_t * lengths,
+    index_t characters_read,
+    float sigma,
+    index_t min_count
+) {
+    // only the two halves of each candidate are needed, so work their significance
+    // out here instead of keeping the whole table up to date every character
+    float expected, stddev;
+    float significance0 = sequence_stats(s.s0, seqs, initial_seq_counts, counts, initial_characters_read, lengths, characters_read, &expected, &stddev);
+    float significance1 = sequence_stats(s.s1, seqs, initial_seq_counts, counts, initial_characters_read, lengths, characters_read, &expected, &stddev);
+
+    return significance0 > SIGMA(sigma) && significance1 > SIGMA(sigma) && 
+        counts[s.s0] > MIN_COUNT(min_count) && counts[s.s1] > MIN_COUNT(min_count);
+}
+
 kernel void is_sequence_significant(
-    global long2 * seq,
-    long total_sequences,
-    global float * significance,
-    global long * counts,
-    long total,
+    global index2_t * seq,
+    index_t total_sequences,
+    global index2_t * seqs,
+    global index2_t * initial_seq_counts,
+    global index_t * counts,
+    global index_t * initial_characters_read,
+    global index_t * lengths,
+    index_t characters_read,
     float sigma,
-    long min_count,
-    global long * output
+    index_t min_count,
+    global index_t * output
 ) {
-    const long gid = get_global_id(0);
+    const index_t gid = get_global_id(0);
     if(gid >= total_sequences)
         return;
 
-    if(significance[seq[gid].s0] > sigma && significance[seq[gid].s1] > sigma && 
-        counts[seq[gid].s0] > min_count && counts[seq[gid].s1] > min_count)
+    if(is_significant(seq[gid], seqs, initial_seq_counts, counts, initial_characters_read, lengths, characters_read, sigma, min_count))
         output[gid] = 1;
     else
         output[gid] = 0;
 }
 
 kernel void find_nexts(
-    global long * tracked, 
-    long total,
-    global long * sorted_current_lengths,
-    long current_total,
-    global long2 * nexts)
+    global index_t * last_completed, 
+    global index_t * active,
+    index_t active_total,
+    index_t position,
+    global index_t * sorted_current_lengths,
+    index_t current_total,
+    global index2_t * nexts,
+    global index_t * next_counts)
 {
-    const long gid = get_global_id(0);
-    if(gid >= total)
+    const index_t gid = get_global_id(0);
+    if(gid >= active_total)
         return;
 
     // is the previous one behind by the length of the current ones?
-    long search_length = -tracked[gid];
+    index_t search_length = position - last_completed[active[gid]];
 
     // do a binary search through the sorted currents for search_length
-    nexts[gid].s0 = lower_bound(search_length, sorted_current_lengths, current_total);
-    nexts[gid].s1 = upper_bound(search_length, sorted_current_lengths, current_total);
+    index_t begin = lower_bound(search_length, sorted_current_lengths, current_total);
+    index_t end = upper_bound(search_length, sorted_current_lengths, current_total);
+    nexts[gid].s0 = begin;
+    nexts[gid].s1 = end;
+
+    // how many nexts this one has, ready to be scanned
+    next_counts[gid] = end - begin;
     // nexts_begin[gid] = 0;
     // nexts_end[gid] = 1;
 }
 
 kernel void gather_seqs(
-    global const long * index,
-    long index_size,
-    global const long2 * seqs,
-    global const long * reverse_index,
-    global long2 * output
+    global const index_t * index,
+    index_t index_size,
+    global const index2_t * seqs,
+    global const index_t * reverse_index,
+    global index2_t * output
 ) {
-    const long gid = get_global_id(0);
+    const index_t gid = get_global_id(0);
     if(gid >= index_size)
         return;
 
-    long2 seq = seqs[index[gid]];
+    index2_t seq = seqs[index[gid]];
 
     seq.s0 = reverse_index[seq.s0];
     seq.s1 = reverse_index[seq.s1];
@@ -127,132 +305,38 @@ kernel void gather_seqs(
     output[gid] = seq;
 }
 
-// TODO: this could be way more efficient
-kernel void depends_on_flagged(
-    global const long2 * seqs,
-    long seqs_size,
-    global long * flagged,
-    global long * output
-) {
-    const long gid = get_global_id(0);
-    if(gid >= seqs_size)
-        return;
-    
-    if(flagged[gid] || flagged[seqs[gid].s0] || flagged[seqs[gid].s1])
-        output[gid] = 1;
-    else
-        output[gid] = 0;
-}
-
-kernel void depends_on_sorted_list(
-    global const long2 * seqs,
-    global const long * sorted,
-    long sorted_total,
-    global const long * begin,
-    long total,
-    global long * output
-) {
-    const long gid = get_global_id(0);
-    if(gid >= total)
-        return;
-
-    long check = seqs[begin[gid]].s0;
-
-    long low = lower_bound(check, sorted, sorted_total);
-    long upp = upper_bound(check, &sorted[low], sorted_total - low);
-
-    if(low < upp) {
-        output[gid] = 1;
-        return;
-    }
-
-    check = seqs[begin[gid]].s1;
-
-    low = lower_bound(check, sorted, sorted_total);
-    upp = upper_bound(check, &sorted[low], sorted_total - low);
-
-    if(low < upp) {
-        output[gid] = 1;
-        return;
-    }
-
-    output[gid] = 0;
-}
-
 kernel void calculate_stats(
-    global long2 * seqs,
-    global long2 * initial_seq_counts,
-    global long * counts,
-    global long * initial_characters_read,
-    global long * lengths,
-    long characters_read,
+    global index2_t * seqs,
+    global index2_t * initial_seq_counts,
+    global index_t * counts,
+    global index_t * initial_characters_read,
+    global index_t * lengths,
+    index_t characters_read,
     global float * stddev_counts,
     global float * expected_counts,
     global float * significance,
-    long total
+    index_t total
 ) {
-    const long gid = get_global_id(0);
+    const index_t gid = get_global_id(0);
     if(gid >= total)
         return;
 
-    // how many a's and b's have we seen since we started tracking ab?
-    long a = counts[seqs[gid].s0] - initial_seq_counts[gid].s0;
-    long b = counts[seqs[gid].s1] - initial_seq_counts[gid].s1;
-
-    if(seqs[gid].s0 == 0 || seqs[gid].s1 == 0 || a == 0 || b == 0) {
-        // this is either an atom which is as significant as it's count, or it's a newly initialized sequence
-        stddev_counts[gid] = 1;
-        expected_counts[gid] = 0;
-        significance[gid] = (float)counts[gid];
-        return;
-    } 
-
-    long a_len = lengths[seqs[gid].s0];
-    long b_len = lengths[seqs[gid].s1];
-    long min_initial = min(initial_characters_read[seqs[gid].s0], initial_characters_read[seqs[gid].s1]);
-    float characters_since = (float)(characters_read - min_initial);
-
-    // characters since a was first spotted minus it's own characters
-    // we subtract one from the overall count because we start initial_characters after the first occurance
-    float characters_since_a = (float)(characters_read - initial_characters_read[seqs[gid].s0] - a_len * (a - 1));
-
-    // characters since b was first completed minus it's own characters
-    float characters_since_b = (float)(characters_read - initial_characters_read[seqs[gid].s1] - b_len * (b - 1));
-
-    // probability that at a given location what follows is a
-    float pa = characters_since_a == 0 ? 1e10 : (float)a / characters_since_a; // As/chars
-    // probability that at the given location what is behind is b
-    float pb = characters_since_b == 0 ? 1e10 : (float)b / characters_since_b; // Bs/chars
-    // probability that we are right between a sequence of ab
-    float pab = pa * pb; // As*Bs/chars^2
-
-
-
-    // probability that any particular location is between a and b
-    expected_counts[gid] = (characters_since - b_len) * pab; // As * Bs / chars
-
-    if(characters_since - b_len == 0) {
-        stddev_counts[gid] = 1;
-        significance[gid] = (float)counts[gid];
-        return;
-    }
-
-    float variation = (characters_since - b_len) * pab * (1. - pab); // As^2 * Bs^2 / chars^3
-
-    stddev_counts[gid] = sqrt(variation);
-
-    significance[gid] = ((float)counts[gid] - expected_counts[gid]) / stddev_counts[gid];
+    float expected, stddev;
+    significance[gid] = sequence_stats(gid, seqs, initial_seq_counts, counts, initial_characters_read, lengths, characters_read, &expected, &stddev);
+    expected_counts[gid] = expected;
+    stddev_counts[gid] = stddev;
 }
 
 kernel void collect_finds(
-    global long2 * nexts,
-    global long * scratch,
-    long total,
-    global long * current,
-    global long2 * found,
-    long found_count
-) {
-    const long gid = get_global_id(0);
+    global index2_t * nexts,
+    global index_t * scratch,
+    index_t total,
+    global index_t * current,
+    global index_t * active,
+    global index2_t * found,
+    index_t found_count
+) {
+    const index_t gid = get_global_id(0);
     if(gid >= found_count)
         return;
 
@@ -264,97 +348,172 @@ kernel void collect_finds(
     // because gid ranges continuously from [0,found_count)
     // and scratch is an inclusive_scan with each step being
     // the length of the next finds
-    long prev = upper_bound(gid, scratch, total);
+    index_t prev = upper_bound(gid, scratch, total);
     
     // prev == 0 means that index 0 (our begin token)
     // has at least one next (scratch[0] > 0 where
     // scratch is a scan of the lengths of nexts)
     // in this case our "first_find" should be 0
-    long first_find = 0;
+    index_t first_find = 0;
     if(prev > 0) 
         first_find = scratch[prev-1];
     
     // our next is the offset of where our nexts begin
     // by our gid from the first find
-    long next = current[nexts[prev].s0 + gid - first_find];
+    index_t next = current[nexts[prev].s0 + gid - first_find];
 
-    // output our results
-    found[gid].s0 = prev;
+    // output our results, prev is a position in the active list
+    found[gid].s0 = active[prev];
     found[gid].s1 = next;
 }
 
+// 1 for the active sequences that are still within reach of the next character
+// and didn't complete on this one, the ones that did are added back separately
+kernel void still_active(
+    global index_t * active,
+    index_t active_total,
+    global index_t * last_completed,
+    global index_t * current_flag,
+    index_t since,
+    global index_t * output
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= active_total)
+        return;
+
+    index_t id = active[gid];
+    output[gid] = !current_flag[id] && last_completed[id] >= since;
+}
+
+// one more occurrence of every current sequence, completing at position.
+// the ids in current are distinct so no two work items touch the same sequence
+kernel void increment_counts(
+    global index_t * current,
+    index_t current_total,
+    index_t position,
+    global index_t * counts,
+    global index_t * last_completed)
+{
+    const index_t gid = get_global_id(0);
+    if(gid >= current_total)
+        return;
+
+    index_t id = current[gid];
+    counts[id]++;
+    last_completed[id] = position;
+}
+
 kernel void scatter_value(
-    global long * indices,
-    long total_indices,
-    long value,
-    global long * output)
+    global index_t * indices,
+    index_t total_indices,
+    index_t value,
+    global index_t * output)
 {
-    const long gid = get_global_id(0);
+    const index_t gid = get_global_id(0);
     if(gid >= total_indices)
         return;
 
     output[indices[gid]] = value;
 }
 
-kernel void mark_exists(
-    global long2 * seqs,
-    long total,
-    global long2 * found,
-    global long * scratch,
-    long found_count
+// slot in a table of mask + 1 entries where we start looking for pair p
+ulong pair_slot(index2_t p, index_t mask) {
+    ulong h = (ulong)p.s0 * 0x9E3779B97F4A7C15UL + (ulong)p.s1;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9UL;
+    h ^= h >> 32;
+    return h & (ulong)mask;
+}
+
+// add key -> id to the hash table
+void insert_pair(index2_t key, index_t id, global index2_t * keys, global index_t * ids, global int * used, index_t mask) {
+    // linear probing, claiming the slot is the only thing that has to be atomic
+    ulong slot = pair_slot(key, mask);
+    while(atomic_cmpxchg(&used[slot], 0, 1) != 0)
+        slot = (slot + 1) & (ulong)mask;
+
+    keys[slot] = key;
+    ids[slot] = id;
+}
+
+// the id of the sequence made of pair value, or 0 if there isn't one
+index_t find_pair(index2_t value, global index2_t * keys, global index_t * ids, global int * used, index_t mask) {
+    for(ulong slot = pair_slot(value, mask); used[slot]; slot = (slot + 1) & (ulong)mask) {
+        if(equal(keys[slot], value))
+            return ids[slot];
+    }
+
+    return 0;
+}
+
+// add sequences [first, last) to the (prev, next) -> id hash table
+kernel void index_pairs(
+    global index2_t * seqs,
+    index_t first,
+    index_t last,
+    global index2_t * keys,
+    global index_t * ids,
+    global int * used,
+    index_t mask
 ) {
-    const long gid = get_global_id(0);
-    if(gid >= total)
+    const index_t gid = first + get_global_id(0);
+    if(gid >= last)
         return;
 
-    // we are looking at all our existing nodes and marking
-    // scratch if this one exists in found
-    long2 value = seqs[gid];
+    // atoms (and the null sequence) aren't pairs
+    index2_t key = seqs[gid];
+    if(key.s0 == 0 && key.s1 == 0)
+        return;
 
-    long low = lower_bound2(value, found, found_count);
-    if(equal(found[low], value)) {
-        scratch[low] = gid;
-    }
+    insert_pair(key, gid, keys, ids, used, mask);
+}
+
+kernel void mark_exists(
+    global index2_t * found,
+    index_t found_count,
+    global index2_t * keys,
+    global index_t * ids,
+    global int * used,
+    index_t mask,
+    global index_t * scratch
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= found_count)
+        return;
+
+    // scratch gets the id of the existing sequence for this find, or 0 if it's new
+    scratch[gid] = find_pair(found[gid], keys, ids, used, mask);
 }
 
 kernel void initialize_newly_found_sequences(
-    global long * new_indices,
-    long new_total,
-    global long2 * found,
-    global long * lengths,
-    global long2 * seqs,
-    global long2 * initial_seq_counts,
-    global long * tracked,
-    global long * counts,
-    long tracked_value,
-    long previous_total
-) {
-    const long gid = get_global_id(0);
+    global index_t * new_indices,
+    index_t new_total,
+    global index2_t * found,
+    global index_t * lengths,
+    global index2_t * seqs,
+    global index2_t * initial_seq_counts,
+    global index_t * last_completed,
+    global index_t * counts,
+    index_t completed_at,
+    index_t previous_total
+) {
+    const index_t gid = get_global_id(0);
     if(gid >= new_total) 
         return;
 
-    long2 s = found[new_indices[gid]];
+    index2_t s = found[new_indices[gid]];
 
-    long new_index = previous_total + gid;
+    index_t new_index = previous_total + gid;
     lengths[new_index] = lengths[s.s0] + lengths[s.s1];
     seqs[new_index] = s;
     counts[new_index] = 0;
     initial_seq_counts[new_index].s0 = counts[s.s0];
     initial_seq_counts[new_index].s1 = counts[s.s1];
-    tracked[new_index] = tracked_value;
+    last_completed[new_index] = completed_at;
 }
 
-kernel void make_pair_constant_second(global long * first, long second, global long2 * output, long total) {
-    const long gid = get_global_id(0);
-    if(gid >= total)
-        return;
-
-    output[gid].s0 = first[gid];
-    output[gid].s1 = second;
-}
-
-kernel void pack(long total, global long *scanned, global long *output) {
-    const long gid = get_global_id(0);
+kernel void pack(index_t total, global index_t *scanned, global index_t *output) {
+    const index_t gid = get_global_id(0);
     if (gid >= total) {
         return;
     }
@@ -367,3 +526,748 @@ kernel void pack(long total, global long *scanned, global long *output) {
         output[scanned[gid - 1]] = gid;
     }
 }
+
+// the scans and reductions of seqt_opencl, which take their temporaries from
+// the arena where boost::compute's would create buffers.  each work group
+// does its own block of the input in local memory, and leaves what its block
+// adds up to for the next level, see seqt_opencl::scan
+
+// what scan_blocks scans
+#define SCAN_VALUES 0   // the input itself
+#define SCAN_EQUAL 1    // 1 where the input is value
+#define SCAN_AT_LEAST 2 // 1 where the input is value or more
+
+kernel void scan_blocks(
+    global index_t * input,
+    index_t total,
+    int mode,
+    index_t value,
+    int exclusive,
+    global index_t * output,
+    global index_t * block_totals,
+    local index_t * partial
+) {
+    const index_t gid = get_global_id(0);
+    const int lid = get_local_id(0);
+    const int size = get_local_size(0);
+
+    index_t x = 0;
+    if(gid < total) {
+        x = input[gid];
+        if(mode == SCAN_EQUAL)
+            x = x == value;
+        else if(mode == SCAN_AT_LEAST)
+            x = x >= value;
+    }
+
+    // every local size works, not just powers of two
+    partial[lid] = x;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for(int offset = 1; offset < size; offset <<= 1) {
+        index_t before = lid >= offset ? partial[lid - offset] : 0;
+        barrier(CLK_LOCAL_MEM_FENCE);
+        partial[lid] += before;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    // input and output can be the same buffer, x was read before anything was written
+    if(gid < total)
+        output[gid] = exclusive ? partial[lid] - x : partial[lid];
+    if(lid == size - 1)
+        block_totals[get_group_id(0)] = partial[lid];
+}
+
+// add the scanned totals of the blocks of block_size before each one
+kernel void scan_add(
+    global index_t * output,
+    index_t total,
+    index_t block_size,
+    global index_t * scanned_totals
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= total)
+        return;
+
+    const index_t block = gid / block_size;
+    if(block > 0)
+        output[gid] += scanned_totals[block - 1];
+}
+
+// the largest of input[first, first + total) for each work group
+kernel void max_blocks(
+    global index_t * input,
+    index_t first,
+    index_t total,
+    global index_t * block_max,
+    local index_t * partial
+) {
+    const index_t gid = get_global_id(0);
+    const int lid = get_local_id(0);
+    const int size = get_local_size(0);
+
+    partial[lid] = gid < total ? input[first + gid] : input[first];
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for(int offset = 1; offset < size; offset <<= 1) {
+        index_t before = lid >= offset ? partial[lid - offset] : partial[lid];
+        barrier(CLK_LOCAL_MEM_FENCE);
+        partial[lid] = max(partial[lid], before);
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if(lid == size - 1)
+        block_max[get_group_id(0)] = partial[lid];
+}
+
+
+// the convergence loop of read_char run entirely on the device, see
+// seqt_opencl::read_on_device.  every count the host loop reads back lives in
+// state, indexed by the LOOP_ constants (seqt_opencl::loop has the same list),
+// and lists are appended to with atomics so nothing has to be sized on the
+// host.  none of the lists need an order: candidates are judged as a set and
+// new sequences get their ids in (prev, next) order from a radix sort of their
+// packed pairs.  when something needs the host, state[LOOP_HALT] says what and
+// every kernel after it does nothing
+#define LOOP_HALT 0
+#define LOOP_HALT_AT 1          // the character of the batch it halted on
+#define LOOP_CHARACTER 2        // the character of the batch being read
+#define LOOP_RUNNING 3          // 1 until the frontier of this character runs out
+#define LOOP_PASS 4             // passes started on this character
+#define LOOP_TOTAL 5
+#define LOOP_MAX_LENGTH 6
+#define LOOP_ACTIVE_SINCE 7
+#define LOOP_ACTIVE_COUNT 8
+#define LOOP_REBUILD 9          // 1 while the active list is being rebuilt
+#define LOOP_FRONTIER 10
+#define LOOP_NEXT_FRONTIER 11
+#define LOOP_FOUND 12
+#define LOOP_NEW 13
+#define LOOP_EXISTING 14
+#define LOOP_PASSED 15          // candidates passed over so far on this character
+#define LOOP_JUDGED 16          // the LOOP_STATS they were judged against
+#define LOOP_STATS 17           // _stats_characters_read
+#define LOOP_MODE 18            // what this pass does with its new candidates
+#define LOOP_MOVED 19           // how many candidates move between new_finds and passed_over
+#define LOOP_JUDGE_COUNT 20
+#define LOOP_ADDED 21
+#define LOOP_REMOVE 22          // the table is full
+#define LOOP_CHARACTERS 23      // fixpoint_stats of the batch
+#define LOOP_PASSES 24
+#define LOOP_FRONTIER_TOTAL 25
+#define LOOP_FRONTIER_MAX 26
+#define LOOP_CANDIDATES 27
+#define LOOP_MAX_PASSES 28      // most passes any character of the batch took
+
+#define LOOP_HALTED_UNFINISHED 1 // the frontier hadn't run out after the last pass enqueued
+#define LOOP_HALTED_PRUNE 2      // converged, but the table has to be pruned
+#define LOOP_HALTED_OVERFLOW 3   // a list outgrew its buffer, the pass didn't change anything
+
+#define LOOP_JUDGE_NEW 0         // judge the new candidates
+#define LOOP_JUDGE_AGAIN 1       // and the ones passed over, the statistics have moved since
+#define LOOP_PASS_OVER 2         // the table is full, pass over the new candidates
+
+#define LOOP_STOPPED(state) (state[LOOP_HALT] || !state[LOOP_RUNNING])
+
+#define LOOP_NO_KEY ULONG_MAX     // the sort key of a candidate that isn't added, sorted after the rest
+
+void loop_halt(global int * state, int reason) {
+    state[LOOP_HALT] = reason;
+    state[LOOP_HALT_AT] = state[LOOP_CHARACTER];
+}
+
+// the host does this pass over again, so it isn't counted
+void loop_undo_pass(global int * state) {
+    state[LOOP_PASS]--;
+    state[LOOP_PASSES]--;
+    state[LOOP_FRONTIER_TOTAL] -= state[LOOP_FRONTIER];
+}
+
+kernel void loop_begin_character(global int * state, int character, index_t position) {
+    if(get_global_id(0) != 0 || state[LOOP_HALT])
+        return;
+
+    state[LOOP_CHARACTER] = character;
+    state[LOOP_RUNNING] = 1;
+    state[LOOP_PASS] = 0;
+    state[LOOP_FRONTIER] = 0;
+    state[LOOP_PASSED] = 0;
+    state[LOOP_REMOVE] = 0;
+    state[LOOP_STATS] = position;
+    state[LOOP_JUDGED] = position;
+    state[LOOP_CHARACTERS]++;
+}
+
+// the current sequences and the first frontier
+kernel void loop_flag_current(
+    global int * state,
+    index_t capacity,
+    index_t atom,
+    index_t position,
+    global index_t * last_completed,
+    global index_t * current_flag,
+    global index_t * frontier
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || state[LOOP_HALT])
+        return;
+
+    index_t flag = gid < state[LOOP_TOTAL] && (gid == atom || last_completed[gid] == position);
+    current_flag[gid] = flag;
+    if(flag)
+        frontier[atomic_inc(&state[LOOP_FRONTIER])] = gid;
+}
+
+kernel void loop_begin_pass(global int * state, index_t position) {
+    if(get_global_id(0) != 0)
+        return;
+
+    state[LOOP_REBUILD] = 0;
+    if(LOOP_STOPPED(state))
+        return;
+
+    int frontier = state[LOOP_FRONTIER];
+    if(frontier == 0) {
+        state[LOOP_RUNNING] = 0;
+        return;
+    }
+
+    state[LOOP_PASS]++;
+    state[LOOP_PASSES]++;
+    state[LOOP_FRONTIER_TOTAL] += frontier;
+    state[LOOP_FRONTIER_MAX] = max(state[LOOP_FRONTIER_MAX], frontier);
+
+    state[LOOP_FOUND] = 0;
+    state[LOOP_NEW] = 0;
+    state[LOOP_EXISTING] = 0;
+    state[LOOP_NEXT_FRONTIER] = 0;
+    state[LOOP_ADDED] = 0;
+
+    // only the sequences that completed within the longest length of this one can come right before a current one
+    int since = position - state[LOOP_MAX_LENGTH];
+    if(state[LOOP_ACTIVE_SINCE] > since) {
+        state[LOOP_ACTIVE_SINCE] = since;
+        state[LOOP_ACTIVE_COUNT] = 0;
+        state[LOOP_REBUILD] = 1;
+    }
+}
+
+// every sequence that completed at or after LOOP_ACTIVE_SINCE
+kernel void loop_rebuild_active(
+    global int * state,
+    index_t capacity,
+    global index_t * last_completed,
+    global index_t * active
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || state[LOOP_HALT] || !state[LOOP_REBUILD])
+        return;
+
+    if(gid < state[LOOP_TOTAL] && last_completed[gid] >= state[LOOP_ACTIVE_SINCE])
+        active[atomic_inc(&state[LOOP_ACTIVE_COUNT])] = gid;
+}
+
+// the frontier of this pass chained by length, so an active sequence only looks
+// at the frontier sequences it can be followed by.  heads has a power of two
+// slots, all -1 between passes, and links[i] is the entry chained after frontier[i]
+kernel void loop_hash_frontier(
+    global int * state,
+    index_t capacity,
+    global index_t * lengths,
+    global index_t * frontier,
+    global int * heads,
+    global int * links,
+    int slot_mask
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || LOOP_STOPPED(state) || gid >= state[LOOP_FRONTIER])
+        return;
+
+    int slot = lengths[frontier[gid]] & slot_mask;
+    links[gid] = atomic_xchg(&heads[slot], (int)gid);
+}
+
+// back to all -1 for the next pass, only the slots of this frontier were used
+kernel void loop_unhash_frontier(
+    global int * state,
+    index_t capacity,
+    global index_t * lengths,
+    global index_t * frontier,
+    global int * heads,
+    int slot_mask
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || LOOP_STOPPED(state) || gid >= state[LOOP_FRONTIER])
+        return;
+
+    heads[lengths[frontier[gid]] & slot_mask] = -1;
+}
+
+// every (active, frontier) pair where the frontier sequence is as long as the active one is behind
+kernel void loop_find_candidates(
+    global int * state,
+    index_t capacity,
+    index_t position,
+    global index_t * last_completed,
+    global index_t * active,
+    global index_t * lengths,
+    global index_t * frontier,
+    global index2_t * found,
+    int found_capacity,
+    global int * heads,
+    global int * links,
+    int slot_mask
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || LOOP_STOPPED(state) || gid >= state[LOOP_ACTIVE_COUNT])
+        return;
+
+    index_t prev = active[gid];
+    index_t search_length = position - last_completed[prev];
+
+    // the chain also holds the lengths that share the slot
+    for(int i = heads[search_length & slot_mask]; i >= 0; i = links[i]) {
+        index_t next = frontier[i];
+        if(lengths[next] != search_length)
+            continue;
+
+        // counted even when it doesn't fit, so loop_decide can tell
+        int slot = atomic_inc(&state[LOOP_FOUND]);
+        if(slot < found_capacity) {
+            found[slot].s0 = prev;
+            found[slot].s1 = next;
+        }
+    }
+}
+
+// split the candidates into the sequences that exist and the pairs that are new
+kernel void loop_mark_exists(
+    global int * state,
+    int found_capacity,
+    global index2_t * found,
+    global index2_t * keys,
+    global index_t * ids,
+    global int * used,
+    index_t mask,
+    global index2_t * new_finds,
+    global index_t * existing
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= found_capacity || LOOP_STOPPED(state) || gid >= state[LOOP_FOUND])
+        return;
+
+    index2_t value = found[gid];
+    index_t id = find_pair(value, keys, ids, used, mask);
+    if(id != 0)
+        existing[atomic_inc(&state[LOOP_EXISTING])] = id;
+    else
+        new_finds[atomic_inc(&state[LOOP_NEW])] = value;
+}
+
+kernel void loop_decide(global int * state, int found_capacity, int passed_capacity, index_t max_sequences) {
+    if(get_global_id(0) != 0 || LOOP_STOPPED(state))
+        return;
+
+    int found = state[LOOP_FOUND];
+    int new_count = state[LOOP_NEW];
+    int passed = state[LOOP_PASSED];
+
+    if(found > found_capacity) {
+        loop_undo_pass(state);
+        loop_halt(state, LOOP_HALTED_OVERFLOW);
+        return;
+    }
+
+    // what was passed over earlier in this character still counts against the table
+    if(new_count + passed + state[LOOP_TOTAL] > max_sequences) {
+        if(passed + new_count > passed_capacity) {
+            loop_undo_pass(state);
+            loop_halt(state, LOOP_HALTED_OVERFLOW);
+            return;
+        }
+
+        state[LOOP_MODE] = LOOP_PASS_OVER;
+        state[LOOP_MOVED] = passed;
+        state[LOOP_PASSED] = passed + new_count;
+        state[LOOP_JUDGE_COUNT] = 0;
+        state[LOOP_REMOVE] = 1;
+    } else {
+        // adding sequences moves the statistics on, so whatever was
+        // passed over before that has to be judged again
+        bool again = state[LOOP_JUDGED] != state[LOOP_STATS];
+        int keep = again ? 0 : passed;
+        int judge = new_count + (again ? passed : 0);
+
+        // everything judged could be passed over
+        if(keep + judge > passed_capacity) {
+            loop_undo_pass(state);
+            loop_halt(state, LOOP_HALTED_OVERFLOW);
+            return;
+        }
+
+        state[LOOP_JUDGED] = state[LOOP_STATS];
+        state[LOOP_MODE] = again ? LOOP_JUDGE_AGAIN : LOOP_JUDGE_NEW;
+        state[LOOP_MOVED] = again ? passed : 0;
+        state[LOOP_PASSED] = keep;
+        state[LOOP_JUDGE_COUNT] = judge;
+    }
+
+    state[LOOP_CANDIDATES] += found;
+}
+
+kernel void loop_move_passed(
+    global int * state,
+    int capacity,
+    global index2_t * new_finds,
+    global index2_t * passed_over
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || LOOP_STOPPED(state))
+        return;
+
+    int mode = state[LOOP_MODE];
+    if(mode == LOOP_PASS_OVER && gid < state[LOOP_NEW])
+        passed_over[state[LOOP_MOVED] + gid] = new_finds[gid];
+    else if(mode == LOOP_JUDGE_AGAIN && gid < state[LOOP_MOVED])
+        new_finds[state[LOOP_NEW] + gid] = passed_over[gid];
+}
+
+// the significant candidates get the sort key of their pair (see pair_keys), which
+// loop_add gives ids by once they are sorted.  the rest are passed over, and
+// kept in case the statistics change
+kernel void loop_judge(
+    global int * state,
+    int capacity,
+    global index2_t * new_finds,
+    global ulong * keys,
+    int bits,
+    global index2_t * passed_over,
+    global index2_t * seqs,
+    global index2_t * initial_seq_counts,
+    global index_t * counts,
+    global index_t * initial_characters_read,
+    global index_t * lengths,
+    float sigma,
+    index_t min_count
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || LOOP_STOPPED(state))
+        return;
+
+    keys[gid] = LOOP_NO_KEY;
+    if(gid >= state[LOOP_JUDGE_COUNT])
+        return;
+
+    index2_t s = new_finds[gid];
+    if(is_significant(s, seqs, initial_seq_counts, counts, initial_characters_read, lengths,
+        state[LOOP_STATS], sigma, min_count))
+        keys[gid] = ((ulong)s.s0 << bits) | (ulong)s.s1;
+    else
+        passed_over[atomic_inc(&state[LOOP_PASSED])] = s;
+}
+
+// the significant candidates become sequences.  their keys are sorted, so
+// new sequences get their ids in (prev, next) order
+kernel void loop_add(
+    global int * state,
+    int capacity,
+    global ulong * sorted,
+    int bits,
+    global index_t * lengths,
+    global index2_t * seqs,
+    global index2_t * initial_seq_counts,
+    global index_t * last_completed,
+    global index_t * counts,
+    global index_t * initial_characters_read,
+    global index2_t * keys,
+    global index_t * ids,
+    global int * used,
+    index_t mask,
+    global index_t * current_flag,
+    global index_t * next_frontier,
+    index_t position,
+    index_t characters_read
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || LOOP_STOPPED(state) || gid >= state[LOOP_JUDGE_COUNT])
+        return;
+
+    ulong key = sorted[gid];
+    if(key == LOOP_NO_KEY)
+        return;
+
+    index2_t s;
+    s.s0 = (index_t)(key >> bits);
+    s.s1 = (index_t)(key & ((1UL << bits) - 1));
+
+    index_t id = state[LOOP_TOTAL] + gid;
+    lengths[id] = lengths[s.s0] + lengths[s.s1];
+    seqs[id] = s;
+    counts[id] = 0;
+    initial_seq_counts[id].s0 = counts[s.s0];
+    initial_seq_counts[id].s1 = counts[s.s1];
+    last_completed[id] = position;
+    initial_characters_read[id] = characters_read;
+    insert_pair(s, id, keys, ids, used, mask);
+
+    atomic_max(&state[LOOP_MAX_LENGTH], (int)lengths[id]);
+    atomic_inc(&state[LOOP_ADDED]);
+
+    // all new sequences are current
+    current_flag[id] = 1;
+    next_frontier[atomic_inc(&state[LOOP_NEXT_FRONTIER])] = id;
+}
+
+kernel void loop_flag_existing(
+    global int * state,
+    int capacity,
+    global index_t * existing,
+    global index_t * current_flag,
+    global index_t * next_frontier
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || LOOP_STOPPED(state) || gid >= state[LOOP_EXISTING])
+        return;
+
+    // every pair has its own sequence, so no two work items have the same id
+    index_t id = existing[gid];
+    if(current_flag[id])
+        return;
+
+    current_flag[id] = 1;
+    next_frontier[atomic_inc(&state[LOOP_NEXT_FRONTIER])] = id;
+}
+
+kernel void loop_end_pass(global int * state, index_t characters_read) {
+    if(get_global_id(0) != 0 || LOOP_STOPPED(state))
+        return;
+
+    int added = state[LOOP_ADDED];
+    state[LOOP_TOTAL] += added;
+    if(added > 0)
+        state[LOOP_STATS] = characters_read;
+
+    state[LOOP_FRONTIER] = state[LOOP_NEXT_FRONTIER];
+}
+
+kernel void loop_end_character(global int * state, index_t position) {
+    if(get_global_id(0) != 0 || state[LOOP_HALT])
+        return;
+
+    if(state[LOOP_RUNNING] && state[LOOP_FRONTIER] > 0) {
+        loop_halt(state, LOOP_HALTED_UNFINISHED);
+        return;
+    }
+
+    state[LOOP_RUNNING] = 0;
+    state[LOOP_MAX_PASSES] = max(state[LOOP_MAX_PASSES], state[LOOP_PASS]);
+
+    // pruning ranks the whole table, that is left to the host
+    if(state[LOOP_REMOVE]) {
+        loop_halt(state, LOOP_HALTED_PRUNE);
+        return;
+    }
+
+    // what the next character can reach back to, rebuilt once the counts are in
+    state[LOOP_ACTIVE_SINCE] = position + 1 - state[LOOP_MAX_LENGTH];
+    state[LOOP_ACTIVE_COUNT] = 0;
+    state[LOOP_REBUILD] = 1;
+}
+
+kernel void loop_count_current(
+    global int * state,
+    index_t capacity,
+    global index_t * current_flag,
+    global index_t * counts,
+    global index_t * last_completed,
+    index_t position
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= capacity || state[LOOP_HALT] || gid >= state[LOOP_TOTAL] || !current_flag[gid])
+        return;
+
+    counts[gid]++;
+    last_completed[gid] = position;
+}
+
+// an LSD radix sort of ulong keys, RADIX_BITS bits a pass, see seqt_opencl::radix_sort.
+// every work group counts, and then moves, a block of as many keys as it has
+// work items.  the counts are a histogram in local memory, and the moves a scan
+// in local memory that gives every key its place among the keys of the block
+// with the same digit, which keeps each pass stable
+#define RADIX_BITS 4
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+#define RADIX_DIGIT(key, shift) ((int)((key) >> (shift)) & (RADIX_BUCKETS - 1))
+
+kernel void radix_count(
+    global ulong * keys,
+    index_t total,
+    int shift,
+    global index_t * counts,
+    index_t blocks,
+    local int * histogram
+) {
+    const index_t gid = get_global_id(0);
+    const int lid = get_local_id(0);
+    const int size = get_local_size(0);
+    const index_t block = get_group_id(0);
+
+    for(int d = lid; d < RADIX_BUCKETS; d += size)
+        histogram[d] = 0;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if(gid < total)
+        atomic_inc(&histogram[RADIX_DIGIT(keys[gid], shift)]);
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // digit major, so an exclusive scan of the counts is where each block puts each digit
+    for(int d = lid; d < RADIX_BUCKETS; d += size)
+        counts[d * blocks + block] = histogram[d];
+}
+
+// a count for each digit in 16 bits of a ulong4, which is enough for any work group
+ulong4 radix_one(int digit) {
+    ulong one = 1UL << (16 * (digit & 3));
+    int part = digit >> 2;
+    return (ulong4)(part == 0 ? one : 0, part == 1 ? one : 0, part == 2 ? one : 0, part == 3 ? one : 0);
+}
+
+int radix_field(ulong4 counts, int digit) {
+    int part = digit >> 2;
+    ulong x = part == 0 ? counts.s0 : part == 1 ? counts.s1 : part == 2 ? counts.s2 : counts.s3;
+    return (int)(x >> (16 * (digit & 3))) & 0xffff;
+}
+
+kernel void radix_scatter(
+    global ulong * keys,
+    index_t total,
+    int shift,
+    global index_t * offsets,
+    index_t blocks,
+    global ulong * output,
+    local ulong4 * partial
+) {
+    const index_t gid = get_global_id(0);
+    const int lid = get_local_id(0);
+    const int size = get_local_size(0);
+    const index_t block = get_group_id(0);
+
+    ulong key = 0;
+    int digit = 0;
+    if(gid < total) {
+        key = keys[gid];
+        digit = RADIX_DIGIT(key, shift);
+    }
+
+    // how many keys of each digit there are up to and including this one
+    partial[lid] = gid < total ? radix_one(digit) : (ulong4)(0);
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for(int offset = 1; offset < size; offset <<= 1) {
+        ulong4 before = lid >= offset ? partial[lid - offset] : (ulong4)(0);
+        barrier(CLK_LOCAL_MEM_FENCE);
+        partial[lid] += before;
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+
+    if(gid < total)
+        output[offsets[digit * blocks + block] + radix_field(partial[lid], digit) - 1] = key;
+}
+
+// (prev, next) as one key, prev in the high bits
+kernel void pair_keys(
+    global index2_t * pairs,
+    index_t total,
+    int bits,
+    global ulong * keys
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= total)
+        return;
+
+    keys[gid] = ((ulong)pairs[gid].s0 << bits) | (ulong)pairs[gid].s1;
+}
+
+kernel void pairs_from_keys(
+    global ulong * keys,
+    index_t total,
+    int bits,
+    global index2_t * pairs
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= total)
+        return;
+
+    ulong key = keys[gid];
+    pairs[gid].s0 = (index_t)(key >> bits);
+    pairs[gid].s1 = (index_t)(key & ((1UL << bits) - 1));
+}
+
+// (length, position) as one key, so the sort by it keeps equal lengths in order
+kernel void length_keys(
+    global index_t * lengths,
+    index_t total,
+    int bits,
+    global ulong * keys
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= total)
+        return;
+
+    keys[gid] = ((ulong)lengths[gid] << bits) | (ulong)gid;
+}
+
+kernel void lengths_from_keys(
+    global ulong * keys,
+    index_t total,
+    int bits,
+    global index_t * ids,
+    global index_t * sorted_lengths,
+    global index_t * sorted_ids
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= total)
+        return;
+
+    ulong key = keys[gid];
+    sorted_lengths[gid] = (index_t)(key >> bits);
+    sorted_ids[gid] = ids[key & ((1UL << bits) - 1)];
+}
+
+// the bits of a float as an unsigned integer that orders like the float does,
+// NaN's last and -0 equal to 0
+uint float_key(float s) {
+    if(isnan(s))
+        return 0xFFFFFFFFU;
+    if(s == 0)
+        return 0x80000000U;
+
+    uint bits = as_uint(s);
+    return (bits & 0x80000000U) ? ~bits : bits | 0x80000000U;
+}
+
+// (significance, id) of every sequence but the null sequence as one key, so
+// there are no ties and the order is that of a stable sort by significance
+kernel void significance_keys(
+    global float * significance,
+    index_t total,
+    int bits,
+    global ulong * keys
+) {
+    const index_t gid = get_global_id(0);
+    if(gid + 1 >= total)
+        return;
+
+    keys[gid] = ((ulong)float_key(significance[gid + 1]) << bits) | (ulong)(gid + 1);
+}
+
+kernel void ids_from_keys(
+    global ulong * keys,
+    index_t total,
+    int bits,
+    global index_t * ids
+) {
+    const index_t gid = get_global_id(0);
+    if(gid >= total)
+        return;
+
+    ids[gid] = (index_t)(keys[gid] & ((1UL << bits) - 1));
+}
@@ -0,0 +1,70 @@
+#ifndef __ALPHABET_HPP__
+#define __ALPHABET_HPP__
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// the symbols the engine reads and the atoms they map to.  looking up a
+// symbol that has been read before is one array access, only the first
+// sight of a symbol has to touch the sequence table.
+class alphabet {
+public:
+    enum class kind : uint32_t {
+        code_points, // text, the BMP is direct mapped and anything past it is hashed
+        bytes,       // binary input, all 256 atoms are created up front
+        tokens       // pre-tokenized streams of small integer ids, direct mapped and grown as they show up
+    };
+
+    // the direct table of a token alphabet stops growing here, larger ids are hashed
+    static const uint32_t max_direct_tokens = 1 << 20;
+
+    static const long none = -1;
+
+    // the _last_completed of an atom created up front that hasn't been read,
+    // far enough back that it is never a candidate, and small enough for 32 bit indices
+    static const long not_completed = std::numeric_limits<int>::min() / 2;
+
+    struct atom {
+        long id = none;
+        bool seen = false; // false until the symbol is read, even if the atom was created up front
+    };
+
+    explicit alphabet(kind k = kind::code_points);
+
+    kind get_kind() const { return _kind; }
+
+    // symbols [0, preallocated()) get their atoms before anything is read
+    uint32_t preallocated() const { return _kind == kind::bytes ? 256 : 0; }
+
+    // throws std::out_of_range for a symbol outside of a byte alphabet
+    atom & operator[](uint32_t symbol) {
+        if(symbol < _direct.size())
+            return _direct[symbol];
+        return find_slow(symbol);
+    }
+
+    // the ids have moved: reverse_index[id] is the new id, or 0 if the atom is gone
+    void remap(std::vector<long> const & reverse_index);
+
+    // every symbol that has an atom, in symbol order
+    std::vector<std::pair<uint32_t, atom>> atoms() const;
+
+    // what to print for each atom, by id
+    std::map<long, std::wstring> text() const;
+
+    static const char * name(kind k);
+
+private:
+    atom & find_slow(uint32_t symbol);
+
+    kind _kind;
+    std::vector<atom> _direct;
+    std::unordered_map<uint32_t, atom> _hashed; // code points past the BMP, token ids past max_direct_tokens
+};
+
+#endif // __ALPHABET_HPP__
@@ -0,0 +1,59 @@
+#ifndef __DISPATCHER_HPP__
+#define __DISPATCHER_HPP__
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+
+// picks the host or the device for each call of one of the primitives of seqt.
+// a handful of elements costs less to copy to the host and back than the
+// kernel launches of the device version, how many is measured per device by
+// calibrate the first time an engine starts on it, and kept in a file like the
+// local sizes of launch_tuner.  every decision is counted.
+class dispatcher {
+public:
+    dispatcher() = default;
+    // path keeps the thresholds between runs, empty to keep nothing
+    explicit dispatcher(std::string path);
+
+    enum class side {
+        automatic, // by the calibrated threshold
+        host,
+        device
+    };
+
+    struct primitive {
+        long threshold = 0; // calls on up to this many elements run on the host
+        bool calibrated = false;
+        long host_calls = 0;
+        long device_calls = 0;
+        long host_elements = 0;
+        long device_elements = 0;
+    };
+
+    // whether `name` runs on the host for `size` elements, counted in the stats
+    bool on_host(const char * name, long size);
+
+    // time run(size) on both sides for growing sizes, after setup(size), and keep `name` on
+    // the host up to the largest size it was faster at.  run has to wait for the device
+    void calibrate(const char * name, std::function<void(long)> setup, std::function<void(long)> run);
+    // has `name` been calibrated, here or by an earlier run?
+    bool calibrated(const char * name) const;
+
+    // write the thresholds calibrated so far to the file
+    void save() const;
+
+    // forget the calls counted so far, the thresholds stay
+    void clear();
+
+    void print(std::wostream & os) const;
+
+    side _force = side::automatic;
+    std::map<std::string, primitive> _primitives;
+
+private:
+    std::string _path;
+};
+
+#endif // __DISPATCHER_HPP__
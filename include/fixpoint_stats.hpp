@@ -0,0 +1,27 @@
+#ifndef __FIXPOINT_STATS_HPP__
+#define __FIXPOINT_STATS_HPP__
+
+#include <algorithm>
+
+// counters for the loop in read_char that keeps adding and flagging sequences
+// until nothing changes.  every pass only looks at candidates ending in a
+// sequence that became current on the pass before (the frontier), so the
+// passes per character and the frontier sizes show how much work it does
+struct fixpoint_stats {
+    long characters = 0;     // characters read since construction
+    long passes = 0;         // passes of the loop over all of those characters
+    long frontier_total = 0; // sum of the frontier sizes of every pass
+    long frontier_max = 0;   // the largest single frontier
+    long candidates = 0;     // candidate pairs enumerated from the frontiers
+
+    void add_pass(long frontier_size) {
+        passes++;
+        frontier_total += frontier_size;
+        frontier_max = std::max(frontier_max, frontier_size);
+    }
+
+    double passes_per_character() const { return characters ? (double)passes / characters : 0.; }
+    double mean_frontier() const { return passes ? (double)frontier_total / passes : 0.; }
+};
+
+#endif // __FIXPOINT_STATS_HPP__
@@ -0,0 +1,33 @@
+#ifndef __INDEX_TYPE_HPP__
+#define __INDEX_TYPE_HPP__
+
+#include <boost/compute/types/fundamental.hpp>
+
+#include <algorithm>
+#include <limits>
+
+// what the device columns, the scratch buffers and the kernels hold ids,
+// lengths, counts and positions in.  64 bits unless built with SEQT_INDEX32,
+// which halves all of them but limits a model to index_max characters read
+// (nothing in the table can count past the characters read)
+#ifdef SEQT_INDEX32
+typedef int index_t;
+typedef boost::compute::int2_ index2_t;
+const char index_build_options[] = "-DSEQT_INDEX32";
+#else
+typedef long index_t;
+typedef boost::compute::long2_ index2_t;
+const char index_build_options[] = "";
+#endif
+
+const long index_max = std::numeric_limits<index_t>::max();
+const long index_min = std::numeric_limits<index_t>::min();
+
+// x as an index_t, held at the ends of the range instead of wrapping around.
+// "since never" is numeric_limits<long>::max() on the host, which a 32 bit
+// build has to see as the largest int rather than -1
+inline index_t clamp_index(long x) {
+    return (index_t)std::min(std::max(x, index_min), index_max);
+}
+
+#endif // __INDEX_TYPE_HPP__
@@ -0,0 +1,46 @@
+#ifndef __KERNEL_CACHE_HPP__
+#define __KERNEL_CACHE_HPP__
+
+#include <boost/compute/context.hpp>
+#include <boost/compute/device.hpp>
+#include <boost/compute/program.hpp>
+
+#include <string>
+#include <vector>
+
+// builds OpenCL programs, keeping the compiled binaries on disk so later runs
+// on the same device, driver and source can skip the compiler entirely.
+// binaries live in $SEQT_CACHE_DIR, or $XDG_CACHE_HOME/seqt, or ~/.cache/seqt
+class kernel_cache {
+public:
+    explicit kernel_cache(std::string directory = default_directory());
+
+    // the program for `source` built with `options`, loaded from disk when possible
+    boost::compute::program build(std::string const & source, boost::compute::context const & context,
+        std::string const & options = std::string());
+
+    // where to keep what else is known about `source` built with `options` on the device
+    // of `context` (see launch_tuner and dispatcher), empty when there is no cache directory
+    std::string profile_path(std::string const & source, boost::compute::context const & context,
+        std::string const & options = std::string(), std::string const & extension = ".tune") const;
+
+    // did the last build() come from a cached binary?
+    bool last_was_hit() const { return _last_was_hit; }
+
+    std::string const & directory() const { return _directory; }
+
+    static std::string default_directory();
+
+private:
+    // identifies a binary: anything that changes what the compiler would produce is in here
+    std::string key(std::string const & source, boost::compute::device const & device,
+        std::string const & options) const;
+
+    bool load(std::string const & path, std::vector<unsigned char> & binary) const;
+    void store(std::string const & path, std::vector<unsigned char> const & binary) const;
+
+    std::string _directory;
+    bool _last_was_hit;
+};
+
+#endif // __KERNEL_CACHE_HPP__
@@ -0,0 +1,75 @@
+#ifndef __LAUNCH_TUNER_HPP__
+#define __LAUNCH_TUNER_HPP__
+
+#include <boost/compute/device.hpp>
+#include <boost/compute/kernel.hpp>
+
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// the local size each kernel is launched with.  launches are put into buckets
+// by the power of two their global size rounds up to.  while sweeping is on,
+// the first launches in a bucket sweep the power of two local sizes the kernel
+// allows, timing each one, until the fastest is known.  after that, or with
+// sweeping off, it is a table lookup, and a bucket that was never swept gets
+// the largest local size.  what was decided is kept in a profile file, so
+// later runs on the same device and kernels start out tuned
+class launch_tuner {
+public:
+    launch_tuner() = default;
+    // path is the profile, empty to keep nothing between runs
+    launch_tuner(boost::compute::device const & device, std::string path);
+
+    // the local size to launch k with on global_size work items
+    long local_size(boost::compute::kernel & k, long global_size);
+
+    // is the next launch of k on global_size work items one of a sweep? then it has to be timed on its own
+    bool sweeping(boost::compute::kernel & k, long global_size);
+    // sweep buckets that haven't been decided, off unless turned on
+    void sweep(bool on) { _sweep = on; }
+
+    // has anything been decided, here or by an earlier run?
+    bool tuned() const { return !_profile.empty(); }
+    // take the sizes other has decided, for buckets this one hasn't used yet
+    void merge(launch_tuner const & other);
+    void measured(boost::compute::kernel & k, long global_size, long local_size, double seconds);
+
+    // write the sizes decided so far to the profile
+    void save() const;
+
+    void print(std::wostream & os) const;
+
+private:
+    struct bucket {
+        long local_size = 0; // 0 until it has been decided
+        std::vector<long> candidates;
+        size_t next = 0;     // the candidate being timed
+        int runs = 0;        // how many times it has been
+        double best_seconds = std::numeric_limits<double>::max();
+        long best = 0;
+    };
+
+    struct entry {
+        std::string name;
+        long max_size;
+        long multiple; // CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE
+        std::map<int, bucket> buckets;
+    };
+
+    entry & find(boost::compute::kernel & k);
+    bucket & find(entry & e, long global_size);
+    static int bucket_of(long global_size);
+
+    boost::compute::device _device;
+    std::string _path;
+    std::unordered_map<cl_kernel, entry> _kernels;
+    std::map<std::pair<std::string, int>, long> _profile; // (kernel, bucket) -> local size, as loaded or decided
+    bool _sweep = false;
+};
+
+#endif // __LAUNCH_TUNER_HPP__
@@ -0,0 +1,29 @@
+#ifndef __MAPPED_FILE_HPP__
+#define __MAPPED_FILE_HPP__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// a whole file mapped read only into memory
+class mapped_file {
+public:
+    // throws std::system_error if the file can't be opened or mapped
+    explicit mapped_file(std::string const & path);
+    ~mapped_file();
+
+    mapped_file(mapped_file const &) = delete;
+    mapped_file & operator=(mapped_file const &) = delete;
+
+    const char * data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const char * _data;
+    size_t _size;
+#if _WIN32
+    std::vector<char> _contents; // no mmap, the file is read in instead
+#endif
+};
+
+#endif // __MAPPED_FILE_HPP__
@@ -0,0 +1,96 @@
+#ifndef __PROFILER_HPP__
+#define __PROFILER_HPP__
+
+#include <boost/compute/command_queue.hpp>
+#include <boost/compute/event.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// opt-in timing of where read() spends its time.  with a queue (created with
+// CL_QUEUE_PROFILING_ENABLE) stages are bracketed by markers and measured on
+// the device, without one they are measured with the host clock.  engines
+// hold a null profiler unless profiling was asked for, so when it is off
+// every hook is a null check.
+class profiler {
+public:
+    struct stats {
+        std::string name;
+        long count;
+        double total_ms;
+        double p50_ms;
+        double p90_ms;
+        double p99_ms;
+        double max_ms;
+        double waiting_ms; // kernels only: total time between being queued and starting
+    };
+
+    struct report {
+        std::vector<stats> stages;  // pipeline stages, a stage includes the stages nested in it
+        std::vector<stats> kernels; // every kernel launch, start to end on the device
+        std::vector<stats> host;    // host wall time: whole read() calls and the waits for readbacks
+
+        void print(std::wostream & os) const;
+    };
+
+    // times everything enqueued on the profiler's queue from construction to destruction
+    class stage {
+    public:
+        stage(profiler * p, const char * name);
+        ~stage();
+
+        stage(stage const &) = delete;
+        stage & operator=(stage const &) = delete;
+
+    private:
+        profiler * _p;
+        const char * _name;
+        boost::compute::event _begin;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    // queue is null for an engine that runs on the host
+    explicit profiler(boost::compute::command_queue * queue = nullptr);
+
+    void kernel(std::string const & name, boost::compute::event const & e);
+    void host(const char * name, std::chrono::nanoseconds time);
+
+    // read the timestamps of everything recorded so far, the queue has to be finished
+    void collect();
+
+    report get_report() const;
+    void clear();
+
+private:
+    struct pending_stage {
+        const char * name;
+        boost::compute::event begin;
+        boost::compute::event end;
+    };
+
+    struct pending_kernel {
+        std::string name;
+        boost::compute::event e;
+    };
+
+    struct samples {
+        std::vector<double> ms;
+        double waiting_ms = 0;
+    };
+
+    static std::vector<stats> summarize(std::map<std::string, samples> const & all);
+
+    boost::compute::command_queue * _queue;
+
+    std::vector<pending_stage> _pending_stages;
+    std::vector<pending_kernel> _pending_kernels;
+
+    std::map<std::string, samples> _stages;
+    std::map<std::string, samples> _kernels;
+    std::map<std::string, samples> _host;
+};
+
+#endif // __PROFILER_HPP__
@@ -0,0 +1,140 @@
+#ifndef __SCRATCH_ARENA_HPP__
+#define __SCRATCH_ARENA_HPP__
+
+#include <boost/compute/container/vector.hpp>
+#include <boost/compute/algorithm/copy.hpp>
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+// a stack of reusable device vectors for the temporaries of seqt_opencl::read.
+// buffers are handed out with get() and handed back when the frame they
+// were taken in goes out of scope, so once the largest sizes have been
+// seen reading a character does not create any new buffers.  the scans and
+// reductions are seqt_opencl's own for that reason, boost::compute's create
+// their temporaries; only the sort fallbacks for keys wider than 64 bits,
+// which a table never gets big enough for, still go through it uncounted.
+class scratch_arena {
+public:
+    template<typename T>
+    using vector = boost::compute::vector<T>;
+
+    // everything taken from the arena while a frame is alive goes back to
+    // the arena when the frame is destroyed
+    class frame {
+    public:
+        frame(scratch_arena & arena);
+        ~frame();
+
+        frame(frame const &) = delete;
+        frame & operator=(frame const &) = delete;
+
+    private:
+        scratch_arena & _arena;
+        size_t _longs, _long2s, _floats, _ints, _int2s;
+    };
+
+    scratch_arena(boost::compute::context & context, boost::compute::command_queue & queue);
+
+    // a scratch vector of `size` elements that stays valid until the enclosing frame ends
+    template<typename T>
+    vector<T> & get(size_t size = 0) {
+        auto & p = pool<T>();
+        auto & used = p.used;
+
+        if(used == p.free.size()) {
+            p.free.emplace_back(std::make_unique<vector<T>>(0, _context));
+            _buffers_created++;
+        }
+
+        vector<T> & v = *p.free[used++];
+        fit(v, size);
+        return v;
+    }
+
+    // resize v to `size`, dropping its contents if it has to grow
+    template<typename T>
+    void fit(vector<T> & v, size_t size) {
+        if(size > v.capacity()) {
+            v = vector<T>(grown_capacity(v.capacity(), size), _context);
+            _buffers_created++;
+        }
+
+        v.resize(size, _queue);
+    }
+
+    // resize v to `size`, keeping its contents if it has to grow
+    template<typename T>
+    void grow(vector<T> & v, size_t size) {
+        if(size > v.capacity()) {
+            vector<T> bigger(grown_capacity(v.capacity(), size), _context);
+            boost::compute::copy(v.begin(), v.end(), bigger.begin(), _queue);
+            bigger.resize(v.size(), _queue);
+
+            v = std::move(bigger);
+            _buffers_created++;
+        }
+
+        v.resize(size, _queue);
+    }
+
+    // how many device buffers the arena has had to create so far
+    long buffers_created() const { return _buffers_created; }
+
+private:
+    template<typename T>
+    struct typed_pool {
+        std::vector<std::unique_ptr<vector<T>>> free;
+        size_t used = 0;
+    };
+
+    static size_t grown_capacity(size_t capacity, size_t size) {
+        return std::max(size, 2 * capacity);
+    }
+
+    template<typename T>
+    typed_pool<T> & pool();
+
+    boost::compute::context _context;
+    boost::compute::command_queue _queue;
+
+    typed_pool<long> _longs;
+    typed_pool<boost::compute::long2_> _long2s;
+    typed_pool<float> _floats;
+    typed_pool<int> _ints;
+    typed_pool<boost::compute::int2_> _int2s; // the pairs of a build with 32 bit indices
+
+    long _buffers_created;
+};
+
+template<> inline scratch_arena::typed_pool<long> & scratch_arena::pool<long>() { return _longs; }
+template<> inline scratch_arena::typed_pool<boost::compute::long2_> & scratch_arena::pool<boost::compute::long2_>() { return _long2s; }
+template<> inline scratch_arena::typed_pool<float> & scratch_arena::pool<float>() { return _floats; }
+template<> inline scratch_arena::typed_pool<int> & scratch_arena::pool<int>() { return _ints; }
+template<> inline scratch_arena::typed_pool<boost::compute::int2_> & scratch_arena::pool<boost::compute::int2_>() { return _int2s; }
+
+inline scratch_arena::frame::frame(scratch_arena & arena) :
+    _arena(arena),
+    _longs(arena._longs.used),
+    _long2s(arena._long2s.used),
+    _floats(arena._floats.used),
+    _ints(arena._ints.used),
+    _int2s(arena._int2s.used)
+{ }
+
+inline scratch_arena::frame::~frame() {
+    _arena._longs.used = _longs;
+    _arena._long2s.used = _long2s;
+    _arena._floats.used = _floats;
+    _arena._ints.used = _ints;
+    _arena._int2s.used = _int2s;
+}
+
+inline scratch_arena::scratch_arena(boost::compute::context & context, boost::compute::command_queue & queue) :
+    _context(context),
+    _queue(queue),
+    _buffers_created(0)
+{ }
+
+#endif // __SCRATCH_ARENA_HPP__
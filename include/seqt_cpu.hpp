@@ -0,0 +1,127 @@
+#ifndef __SEQT_CPU_HPP__
+#define __SEQT_CPU_HPP__
+
+#include <boost/compute/types.hpp>
+
+#include <unordered_map>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "alphabet.hpp"
+#include "fixpoint_stats.hpp"
+#include "profiler.hpp"
+#include "thread_pool.hpp"
+
+// host implementation of the seqt engine.  every kernel in cl/kernels.cl has
+// a plain C++ counterpart here that runs over std::vector columns on a
+// thread pool, so no OpenCL program is built and nothing crosses a bus.
+class seqt_cpu {
+public:
+    using long2_ = boost::compute::long2_;
+
+    thread_pool _pool;
+
+    std::vector<long> _counts; // how many times have we seen this?
+
+    std::vector<long> _lengths; // for sequences
+    std::vector<long2_> _seqs; // for sequences
+    std::vector<long2_> _initial_seq_counts; // what were the counts of the children at the time this sequence was created?
+    std::vector<long> _initial_characters_read; // how many characters were read at the time of this sequence creation?
+
+    std::vector<float> _expected_counts;
+    std::vector<float> _stddev_counts;
+    std::vector<float> _significance;
+
+    // the position (counted like _characters_read) of the character each sequence
+    // last completed on, a sequence is _position - _last_completed characters behind
+    std::vector<long> _last_completed;
+
+    // (prev, next) -> id of that sequence, the host side of the device pair index
+    struct pair_hash {
+        size_t operator()(long2_ const & p) const;
+    };
+    struct pair_equal {
+        bool operator()(long2_ const & a, long2_ const & b) const { return a.x == b.x && a.y == b.y; }
+    };
+    std::unordered_map<long2_, long, pair_hash, pair_equal> _pair_index;
+
+    // every sequence with _last_completed >= _active_since, see seqt_opencl::_active
+    std::vector<long> _active;
+    long _active_since;
+    long _max_length; // no sequence is longer than this
+
+    long _total;
+    long _characters_read;
+    long _stats_characters_read; // _characters_read as of the statistics the current character is working from
+    long _position; // position of the character read_char is working on
+
+    fixpoint_stats _fixpoint;
+    std::unique_ptr<profiler> _profiler; // only set when profiling, stages are timed on the host
+
+    float _sigma;
+    float _min_sigma; // what do we throw away during sleep?
+    long _min_occurances;
+    long _max_sequences_tracked;
+
+    alphabet _alphabet;
+
+    long get_char_index(uint32_t symbol);
+    long add_atoms(long count, long last_completed);
+
+    template<typename Pred>
+    std::vector<long> pack(std::vector<long> const & data, Pred pred);
+    void scatter_value(std::vector<long> const & indices, long value, std::vector<long> & output);
+    void find_nexts(std::vector<long> const & sorted_lengths, std::vector<long2_> & nexts, std::vector<long> & next_counts);
+    void increment_counts(std::vector<long> const & current);
+    void collect_finds(std::vector<long2_> const & nexts, std::vector<long> const & scratch, std::vector<long> const & current, std::vector<long2_> & found);
+    void mark_exists(std::vector<long2_> const & found, std::vector<long> & scratch);
+    void index_pairs(long first, long last);
+    void initialize_newly_found_sequences(std::vector<long> const & new_find_indices, std::vector<long2_> const & found, long completed_at);
+    std::vector<long2_> find_nexts_by_length(std::vector<long> & current);
+    void rebuild_active(long since);
+    void update_active(std::vector<long> const & current, std::vector<long> const & current_flag);
+    void is_sequence_significant(std::vector<long2_> const & seq, float sigma, long min_count, std::vector<long> & output);
+    void close_over_flagged(std::vector<long> & flagged);
+    void recreate_from_map(std::vector<long> const & index);
+    void calculate_stats();
+    inline float sequence_stats(long i, long characters_read, float & expected_count, float & stddev_count) const;
+    void gather_seqs(std::vector<long> const & index, std::vector<long> const & reverse_index, std::vector<long2_> & output);
+
+    long flag_existing(std::vector<long> const & existing_indices, std::vector<long> & current_flag, std::vector<long> & newly_flagged);
+    long process_new_finds(std::vector<long2_> const & finds, std::vector<long> & current_flag, std::vector<long2_> & passed_over);
+
+    void reserve(long capacity);
+    void shrink_to_fit();
+
+    long add_new_finds(std::vector<long> const & new_find_indices, std::vector<long2_> const & found, long completed_at);
+
+    void remove_least_significant(long max_sequences);
+
+    template<typename Symbol>
+    void read_symbols(const Symbol * data, size_t length);
+    void read(const wchar_t * data, size_t length);
+    void read(const unsigned char * data, size_t length);
+    void read(const uint32_t * data, size_t length);
+    void read_char(uint32_t symbol);
+    void print_all(std::wostream & os);
+
+    void save(std::string const & path);
+    void load(std::string const & path);
+
+    explicit seqt_cpu(alphabet::kind symbols = alphabet::kind::code_points,
+        size_t threads = std::thread::hardware_concurrency());
+};
+
+template<typename Pred>
+std::vector<long> seqt_cpu::pack(std::vector<long> const & data, Pred pred) {
+    std::vector<long> packed;
+    for(long i = 0; i < (long)data.size(); i++)
+        if(pred(data[i]))
+            packed.push_back(i);
+
+    return packed;
+}
+
+#endif // __SEQT_CPU_HPP__
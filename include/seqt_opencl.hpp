@@ -0,0 +1,356 @@
+#ifndef __SEQT_OPENCL_HPP__
+#define __SEQT_OPENCL_HPP__
+
+#include <boost/compute.hpp>
+
+#include <map>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <chrono>
+
+#include "alphabet.hpp"
+#include "index_type.hpp"
+#include "scratch_arena.hpp"
+#include "kernel_cache.hpp"
+#include "fixpoint_stats.hpp"
+#include "profiler.hpp"
+#include "dispatcher.hpp"
+#include "launch_tuner.hpp"
+
+
+using std::map;
+using std::ostream, std::wostream, std::cout, std::cerr, std::endl;
+using std::ostream_iterator;
+
+using boost::compute::device;
+using boost::compute::context;
+using boost::compute::command_queue;
+using boost::compute::function;
+using boost::compute::program;
+using boost::compute::kernel;
+using boost::compute::buffer_iterator;
+using boost::compute::vector;
+using boost::compute::long2_;
+using boost::compute::event;
+using boost::compute::wait_list;
+
+// BOOST_COMPUTE_FUNCTION(long, is_current, (long tracked), {
+//     if(tracked == 0) 
+//         return 1;
+//     return 0;
+// });
+
+long calc_operational_size(long global_size, long local_size);
+
+// what seqt_opencl::pack keeps: the elements equal to value, or every element at least value.
+// plain enough to be evaluated on the host as well as the device
+struct pack_if {
+    index_t value;
+    bool or_greater;
+
+    static pack_if equal(index_t value) { return { value, false }; }
+    static pack_if at_least(index_t value) { return { value, true }; }
+
+    bool operator()(index_t x) const { return or_greater ? x >= value : x == value; }
+};
+
+// ostream& operator<<(ostream & os, long2_ x) {
+//     os << "(" << 
+// }
+
+// the seqt engine on the default OpenCL device, every step of read() is one of
+// the kernels in cl/kernels.cl.  see seqt for the interface that picks an engine
+class seqt_opencl { 
+public:
+    device _device;
+    context _context;
+    command_queue _queue;
+    // work that read_char doesn't need the result of right away, so the readbacks
+    // on _queue don't wait for it.  made like _queue, see enqueue
+    command_queue _side_queue;
+    bool _overlap; // use _side_queue, off runs everything in order on _queue
+    std::unique_ptr<profiler> _profiler; // only set when profiling, _queue is then created with CL_QUEUE_PROFILING_ENABLE
+    kernel_cache _kernel_cache;
+    program _program;
+    std::string _program_options; // what _program was built with, see build_options
+    std::map<std::string, program> _programs; // every variant built so far, by build options
+    kernel _pack_kernel;
+    kernel _scan_blocks_kernel;
+    kernel _scan_add_kernel;
+    kernel _max_blocks_kernel;
+    kernel _scatter_value_kernel;
+    kernel _increment_counts_kernel;
+    kernel _find_nexts_kernel;
+    kernel _collect_finds_kernel;
+    kernel _mark_exists_kernel;
+    kernel _index_pairs_kernel;
+    kernel _initialize_newly_found_sequences_kernel;
+    kernel _calculate_stats_kernel;
+    kernel _is_sequence_significant_kernel;
+    kernel _still_active_kernel;
+    kernel _gather_seqs_kernel;
+    kernel _loop_begin_character_kernel;
+    kernel _loop_flag_current_kernel;
+    kernel _loop_begin_pass_kernel;
+    kernel _loop_rebuild_active_kernel;
+    kernel _loop_hash_frontier_kernel;
+    kernel _loop_find_candidates_kernel;
+    kernel _loop_unhash_frontier_kernel;
+    kernel _loop_mark_exists_kernel;
+    kernel _loop_decide_kernel;
+    kernel _loop_move_passed_kernel;
+    kernel _loop_judge_kernel;
+    kernel _loop_add_kernel;
+    kernel _loop_flag_existing_kernel;
+    kernel _loop_end_pass_kernel;
+    kernel _loop_end_character_kernel;
+    kernel _loop_count_current_kernel;
+    kernel _radix_count_kernel;
+    kernel _radix_scatter_kernel;
+    kernel _pair_keys_kernel;
+    kernel _pairs_from_keys_kernel;
+    kernel _length_keys_kernel;
+    kernel _lengths_from_keys_kernel;
+    kernel _significance_keys_kernel;
+    kernel _ids_from_keys_kernel;
+
+    // reusable device memory for the temporaries of read()
+    scratch_arena _arena;
+
+    // which of pack, compact and the sorts run on the host, see calibrate_dispatch
+    dispatcher _dispatch;
+
+    // the local size of every launch of the kernels in cl/kernels.cl
+    launch_tuner _tuner;
+
+    vector<index_t> _counts; // how many times have we seen this?
+
+    vector<index_t> _lengths; // for sequences
+    vector<index2_t> _seqs; // for sequences
+    vector<index2_t> _initial_seq_counts; // what were the counts of the children at the time this sequence was created?
+    vector<index_t> _initial_characters_read; // how many characters were read at the time of this sequence creation?
+
+    vector<float> _expected_counts;
+    vector<float> _stddev_counts;
+    vector<float> _significance;
+
+    // vector<long> _depths; // for sets;
+    // vector<long> _lefts; // for sets
+    // vector<long> _rights; // for sets
+
+    // the position (counted like _characters_read) of the character each sequence
+    // last completed on, a sequence is _position - _last_completed characters behind
+    vector<index_t> _last_completed;
+
+    // open addressing hash table from (prev, next) to the id of that sequence, so
+    // finds can be looked up without sorting them or scanning every sequence
+    vector<index2_t> _pair_keys;
+    vector<index_t> _pair_ids;
+    vector<int> _pair_used; // 1 if the slot holds a pair
+    long _pair_capacity; // number of slots, a power of two at least twice _capacity
+
+    // the sequences that completed recently enough to come right before a current one.
+    // every sequence with _last_completed >= _active_since is listed, so candidates
+    // are only looked for among these instead of across the whole table
+    vector<index_t> _active;
+    vector<index_t> _active_next; // the next list is built here and swapped in
+    long _active_since;
+    long _max_length; // no sequence is longer than this
+
+    long _total;  
+    long _capacity; // how many sequences the columns can hold before they have to be reallocated
+    long _characters_read;
+    long _stats_characters_read; // _characters_read as of the statistics the current character is working from
+    long _position; // position of the character read_char is working on
+
+    fixpoint_stats _fixpoint;
+
+    // run the convergence loop of whole batches of characters on the device, see
+    // read_on_device.  everything is enqueued up front, sized for the worst case,
+    // and the host only reads the loop state back once per batch.  off unless
+    // turned on, whatever the device can't finish falls back to read_char
+    bool _device_loop;
+    long _device_loop_batch;  // characters enqueued between readbacks
+    long _device_loop_passes; // passes enqueued per character, a character that needs more is finished on the host
+    long _device_loop_found;  // room for the candidates of one pass
+    long _device_loop_passed; // room for the candidates passed over on one character
+
+    // where the loop_ kernels keep their counts, the same as the LOOP_ defines in cl/kernels.cl
+    struct loop {
+        enum {
+            halt, halt_at, character, running, pass, total, max_length, active_since, active_count, rebuild,
+            frontier, next_frontier, found, new_finds, existing, passed, judged, stats, mode, moved,
+            judge_count, added, remove, characters, passes, frontier_total, frontier_max, candidates, max_passes,
+            size
+        };
+
+        // why the device stopped, it stops on the first character the host has to finish
+        enum halted {
+            unfinished = 1, // still converging after _device_loop_passes passes
+            prune = 2,      // converged, but the table is full
+            overflow = 3    // a pass found more than _device_loop_found or _device_loop_passed
+        };
+    };
+
+    // build the kernels with _sigma, _min_occurances and the largest search the
+    // table allows compiled in, see specialize
+    bool _specialize;
+
+    bool _kernels_from_cache; // the constructor loaded the kernels instead of building them
+
+    // time the host spent blocked on the device inside read(), and how many times it blocked
+    std::chrono::nanoseconds _stall_time;
+    long _stall_count;
+
+    // adds the time from construction to destruction to _stall_time
+    struct stall_timer {
+        seqt_opencl & _s;
+        const char * _name; // what the profiler files the wait under
+        std::chrono::steady_clock::time_point _start;
+
+        stall_timer(seqt_opencl & s, const char * name = "readback");
+        ~stall_timer();
+    };
+
+    float _sigma;
+    float _min_sigma; // what do we throw away during sleep?
+    long _min_occurances;
+    long _max_sequences_tracked;
+
+    alphabet _alphabet;
+
+    long get_char_index(uint32_t symbol);
+    long add_atoms(long count, long last_completed);
+
+    // blocking read of a single value, counted as a stall
+    long read_back(buffer_iterator<index_t> position);
+
+    // what the kernels are built with, only the index width unless the engine is specialized
+    std::string build_options() const;
+    // switch to the program built with build_options(), building it if no earlier one was
+    void select_program();
+    // specialized programs are rebuilt whenever what they fold in changes: a new capacity,
+    // _sigma or _min_occurances.  every variant is kept, and cached on disk like the generic one
+    void specialize(bool on = true);
+
+    // every kernel is launched through here so the profiler sees it
+    event enqueue(kernel & k, long global_size, long local_size, const wait_list & events = wait_list());
+    // the same on `queue`, which, if it is _side_queue, starts after everything enqueued on _queue so far
+    event enqueue(command_queue & queue, kernel & k, long global_size, long local_size, const wait_list & events = wait_list());
+    // the queue for work that can go on the side, _side_queue unless _overlap is off
+    command_queue & side_queue();
+    // wait for both queues
+    void finish();
+
+    // what profiling has measured so far, empty unless the engine was made with profiling on
+    profiler::report profile();
+
+    // the primitives that run on the host when they are given few enough elements
+    void pack(vector<index_t> & data, pack_if pred, vector<index_t> & packed);
+    void compact(vector<index_t> & data, vector<index_t> & nonzero); // the non-zero elements of data, in order
+
+    // what scan() adds up, the same as SCAN_VALUES and the rest in cl/kernels.cl
+    enum scan_mode { scan_values = 0, scan_equal = 1, scan_at_least = 2 };
+    // the running sum of input (or of input == value, input >= value) into output, which can be input.
+    // unlike boost::compute's scans every temporary comes from _arena
+    void scan(vector<index_t> & input, vector<index_t> & output, bool exclusive = false, scan_mode mode = scan_values, index_t value = 0);
+    // the largest of data[first, first + count), 0 when there are none.  waits for the device
+    long reduce_max(vector<index_t> & data, long first, long count);
+    void sort_pairs(vector<index2_t> & pairs); // by (prev, next)
+    void sort_pairs(vector<index2_t> & pairs, int id_bits); // every id below 2^id_bits
+    void sort_by_length(vector<index_t> & lengths, vector<index_t> & ids); // stable
+    void sort_by_length(vector<index_t> & lengths, vector<index_t> & ids, int length_bits); // every length below 2^length_bits
+    // sort keys, as unsigned, by their low `bits` bits.  a pass a digit, so the fewer bits the keys use the better
+    void radix_sort(vector<long> & keys, int bits);
+    event pair_keys(vector<index2_t> & pairs, int bits, vector<long> & keys, const wait_list & events = wait_list());
+    event pairs_from_keys(vector<long> & keys, int bits, vector<index2_t> & pairs, const wait_list & events = wait_list());
+    event length_keys(vector<index_t> & lengths, int bits, vector<long> & keys, const wait_list & events = wait_list());
+    event lengths_from_keys(vector<long> & keys, int bits, vector<index_t> & ids, vector<index_t> & sorted_lengths, vector<index_t> & sorted_ids, const wait_list & events = wait_list());
+    event significance_keys(int bits, vector<long> & keys, const wait_list & events = wait_list());
+    event ids_from_keys(vector<long> & keys, long count, int bits, vector<index_t> & ids, const wait_list & events = wait_list());
+    // the dispatch thresholds of this device, calibrated by the first engine on it
+    // (that runs in this process, or keeps them on disk) and loaded by the rest
+    void calibrate_dispatch();
+    // the local sizes of this device, swept once by a throwaway engine reading a
+    // sample (in this process, or by an earlier one that kept them on disk), so
+    // read() never waits on a sweep
+    void tune();
+    event scatter_value(vector<index_t> & indices, long value, vector<index_t> & output, const wait_list & events = wait_list());
+    // count another occurrence of each of `current` and mark them as completing at _position
+    event increment_counts(vector<index_t> & current, const wait_list & events = wait_list());
+    event find_nexts(vector<index_t> & sorted_lengths, vector<index2_t> & nexts, vector<index_t> & next_counts, const wait_list & events = wait_list());
+    event collect_finds(vector<index2_t> & nexts_begin, vector<index_t> & scratch, vector<index_t> & current, vector<index2_t> & found, const wait_list & events = wait_list());
+    event mark_exists(vector<index2_t> & found, vector<index_t> & scratch, const wait_list & events = wait_list());
+    event index_pairs(long first, long last, const wait_list & events = wait_list());
+    void rebuild_pair_index();
+    event initialize_newly_found_sequences(vector<index_t> & new_find_indices, vector<index2_t> & found, long completed_at, const wait_list & events = wait_list());
+    void find_nexts_by_length(vector<index_t> & current, vector<index2_t> & found);
+    void rebuild_active(long since);
+    void update_active(vector<index_t> & current, vector<index_t> & current_flag);
+    long active_size() const;
+    fixpoint_stats const & fixpoint() const;
+    alphabet::kind alphabet_kind() const;
+    event is_sequence_significant(vector<index2_t> & seq, float sigma, long min_count, vector<index_t> & output, const wait_list & events = wait_list());
+    void close_over_flagged(vector<index_t> & flagged);
+    void recreate_from_map(vector<index_t> & index);
+    event calculate_stats(const wait_list & events = wait_list());
+    event calculate_stats(command_queue & queue, const wait_list & events = wait_list());
+    event gather_seqs(vector<index_t> & index, vector<index_t> & reverse_index, vector<index2_t> & output, const wait_list & events = wait_list());
+
+    long flag_existing(vector<index_t> & existing_indices, vector<index_t> & current_flag, vector<index_t> & newly_flagged);
+    long process_new_finds(vector<index2_t> & finds, vector<index_t> & current_flag, vector<index2_t> & passed_over);
+
+    // reserve room for `capacity` sequences in every column, or give back what isn't used
+    void reserve(long capacity);
+    void shrink_to_fit();
+    void resize_columns(long total);
+
+    long add_new_finds(vector<index_t> & new_find_indices, vector<index2_t> & found, long completed_at);
+
+    void remove_least_significant(long max_sequences);
+    // the ids of the ids.size() least significant sequences, in no order.  the radix
+    // sort takes 32 bits for the significance and as many as the ids need, the
+    // selection with nth_element_struct is for when that's more than 64
+    void least_significant_by_radix(vector<index_t> & ids);
+    void least_significant_by_selection(vector<index_t> & ids);
+
+    template<typename T>
+    void print(std::wostream & os, vector<T> & v); 
+
+    void read(wchar_t c);
+    // read a whole block of characters, the host only waits for the device at the end of the block
+    void read(const wchar_t * data, size_t length);
+    void read(const unsigned char * data, size_t length); // for alphabet::kind::bytes
+    void read(const uint32_t * data, size_t length); // for alphabet::kind::tokens
+    void read(std::wstring_view data);
+    void read_char(uint32_t symbol);
+    // the passes of read_char until the frontier runs out, returns whether the table has to be pruned
+    bool converge(vector<index_t> & frontier, vector<index_t> & current_flag, vector<index2_t> & passed_over,
+        long passed_over_judged_at, bool do_remove_least_significant);
+    // counts, active list and pruning once a character has converged
+    void finish_char(vector<index_t> & current_flag, bool do_remove_least_significant);
+    template<typename Symbol>
+    void read_symbols(const Symbol * data, size_t length);
+    // read up to _device_loop_batch symbols with the loop on the device, returns how many were read
+    template<typename Symbol>
+    size_t read_on_device(const Symbol * symbols, size_t length);
+    event enqueue_loop(kernel & k, long global_size);
+    void print_all(std::wostream & os);
+
+    // write the whole model to `path`, or replace it with one written earlier (see snapshot.hpp)
+    void save(std::string const & path);
+    void load(std::string const & path);
+
+    // tuning sweeps the local sizes of a device that has none yet, see tune
+    explicit seqt_opencl(alphabet::kind symbols = alphabet::kind::code_points, bool profiling = false, bool tuning = true);
+}; 
+
+    
+
+
+#endif // __SEQT_OPENCL_HPP__
\ No newline at end of file
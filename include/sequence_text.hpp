@@ -0,0 +1,31 @@
+#ifndef __SEQUENCE_TEXT_HPP__
+#define __SEQUENCE_TEXT_HPP__
+
+#include <boost/compute/types.hpp>
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// the text of every sequence, decoded from the (prev, next) pairs in one
+// pass without recursion and kept in a single flat buffer.  nothing is
+// stored per sequence while reading, this is only built to print.
+class sequence_text {
+public:
+    using long2_ = boost::compute::long2_;
+
+    // atoms are the sequences whose pair is (0, 0), their text comes from atom_text (see alphabet::text)
+    sequence_text(std::vector<long2_> const & seqs, std::map<long, std::wstring> const & atom_text);
+
+    std::wstring_view operator[](long i) const {
+        return std::wstring_view(_chars.data() + _offsets[i], _lengths[i]);
+    }
+
+private:
+    std::wstring _chars;
+    std::vector<long> _offsets;
+    std::vector<long> _lengths; // -1 until decoded
+};
+
+#endif // __SEQUENCE_TEXT_HPP__
@@ -0,0 +1,123 @@
+#ifndef __SNAPSHOT_HPP__
+#define __SNAPSHOT_HPP__
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "alphabet.hpp"
+#include "mapped_file.hpp"
+
+// the on disk format of seqt::save / seqt::load.
+//
+// a header, then one block per column aligned to snapshot_alignment, then a
+// directory of the columns at the end of the file.  columns are raw arrays
+// in the byte order and element sizes of the machine that wrote them, so
+// loading is a bounds check and a copy of each column into its buffer.
+namespace snapshot {
+
+const uint32_t version = 3; // 2: tracked (relative) became last_completed (absolute), 3: alphabets
+const uint32_t byte_order = 0x01020304;
+const uint64_t alignment = 64;
+
+enum column_id : uint32_t {
+    counts = 1,
+    lengths,
+    seqs,
+    initial_seq_counts,
+    initial_characters_read,
+    last_completed,
+    expected_counts,
+    stddev_counts,
+    significance,
+    char_index_chars,   // symbols of the atoms
+    char_index_ids      // sequence id of the atom with the same row in char_index_chars
+};
+
+struct header {
+    char magic[8];              // "SEQTSNAP"
+    uint32_t version;
+    uint32_t byte_order;        // byte_order as written, anything else was written on another kind of machine
+    uint64_t column_count;
+    uint64_t directory_offset;
+
+    int64_t total;
+    int64_t characters_read;
+    int64_t stats_characters_read;
+
+    float sigma;
+    float min_sigma;
+    int64_t min_occurances;
+    int64_t max_sequences_tracked;
+
+    uint32_t alphabet;          // alphabet::kind the symbols are in
+    uint32_t unused;
+};
+
+struct column {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t rows;
+    uint64_t offset;
+};
+
+class writer {
+public:
+    // throws std::runtime_error if the file can't be created
+    explicit writer(std::string const & path);
+
+    void write_column(column_id id, uint32_t element_size, uint64_t rows, const void * data);
+
+    template<typename T>
+    void write_column(column_id id, std::vector<T> const & data) {
+        write_column(id, sizeof(T), data.size(), data.data());
+    }
+
+    // writes the directory and the header, nothing is readable until this is called
+    void finish(header h);
+
+private:
+    std::ofstream _file;
+    std::string _path;
+    std::vector<column> _columns;
+};
+
+class reader {
+public:
+    // maps the file and checks the header and directory, throws std::runtime_error if it isn't a snapshot we can read
+    explicit reader(std::string const & path);
+
+    header const & get_header() const { return _header; }
+    std::string const & path() const { return _path; }
+
+    // the rows of column `id`, which has to hold elements of `element_size` bytes
+    const void * get_column(column_id id, uint32_t element_size, uint64_t & rows) const;
+
+    template<typename T>
+    const T * get_column(column_id id, uint64_t & rows) const {
+        return static_cast<const T *>(get_column(id, sizeof(T), rows));
+    }
+
+private:
+    mapped_file _file;
+    std::string _path;
+    header _header;
+    std::vector<column> _columns;
+};
+
+// throws std::runtime_error unless every sequence is made of sequences before
+// it, 0 <= prev, next < id, or is an atom (prev == next == 0).  the engines
+// close over the table in id order and rely on it
+void check_seqs(reader const & r);
+
+// the char_index columns for the atoms of `a`
+void write_alphabet(writer & w, alphabet const & a);
+
+// the alphabet of the snapshot.  an atom that was made up front counts as
+// seen once it has completed, last_completed is the snapshot's column of that name
+alphabet read_alphabet(reader const & r, const long * last_completed);
+
+} // namespace snapshot
+
+#endif // __SNAPSHOT_HPP__
@@ -0,0 +1,58 @@
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed set of workers that split [0, total) into chunks, used by the
+// host backend the same way the device splits a kernel into work groups
+class thread_pool {
+public:
+    // ranges smaller than this are run on the calling thread
+    static constexpr long grain_size = 4096;
+
+    explicit thread_pool(size_t threads = std::thread::hardware_concurrency());
+    ~thread_pool();
+
+    thread_pool(thread_pool const &) = delete;
+    thread_pool & operator=(thread_pool const &) = delete;
+
+    size_t size() const { return _threads.size() + 1; }
+
+    // calls f(begin, end) on disjoint chunks covering [0, total) and returns once all are done
+    template<typename F>
+    void parallel_for(long total, F && f) {
+        if(total <= 0)
+            return;
+
+        if(total < 2 * grain_size || _threads.empty()) {
+            f(0L, total);
+            return;
+        }
+
+        run(total, std::function<void(long, long)>(std::forward<F>(f)));
+    }
+
+private:
+    void run(long total, std::function<void(long, long)> job);
+    void work();
+    void work_chunks();
+
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _start;
+    std::condition_variable _done;
+
+    std::function<void(long, long)> _job;
+    long _total;
+    std::atomic<long> _next;
+    long _busy;
+    unsigned long _generation;
+    bool _stop;
+};
+
+#endif // __THREAD_POOL_HPP__
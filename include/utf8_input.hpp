@@ -0,0 +1,27 @@
+#ifndef __UTF8_INPUT_HPP__
+#define __UTF8_INPUT_HPP__
+
+#include <cstddef>
+
+// decodes UTF-8 into code points a block at a time.  runs of ASCII are
+// widened 16 bytes at a time, anything malformed becomes U+FFFD.
+class utf8_decoder {
+public:
+    utf8_decoder(const char * begin, const char * end);
+
+    // decode up to `capacity` code points into `out`, returns how many were written
+    size_t decode(wchar_t * out, size_t capacity);
+
+    bool done() const { return _next == _end; }
+    size_t bytes_consumed() const { return _next - _begin; }
+
+private:
+    // decode the multi byte (or malformed) sequence at _next
+    wchar_t decode_one();
+
+    const unsigned char * _begin;
+    const unsigned char * _next;
+    const unsigned char * _end;
+};
+
+#endif // __UTF8_INPUT_HPP__
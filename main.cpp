@@ -69,17 +69,146 @@ void init_locale(void)
 }
 
 #include "seqt.hpp"
+#include "mapped_file.hpp"
+#include "utf8_input.hpp"
 
+#include <cstring>
+#include <stdexcept>
 #include <string>
 
+// hand the engine whole blocks so it only syncs with the device once per block.
+// decode(block, capacity) fills block with up to capacity symbols and returns how many
+template<typename Symbol, typename Decode>
+void read_blocks(seqt & s, Decode decode) {
+    constexpr size_t block_size = 4096;
+    Symbol block[block_size];
+
+    // progress goes out a few times a second however fast the blocks go by
+    constexpr auto progress_interval = std::chrono::milliseconds(250);
+    auto last_progress = std::chrono::steady_clock::now();
+
+    while(size_t length = decode(block, block_size)) {
+        s.read(block, length);
+
+        auto now = std::chrono::steady_clock::now();
+        if(now - last_progress >= progress_interval) {
+            wcout << ".";
+            wcout.flush();
+            last_progress = now;
+        }
+    }
+    wcout << endl;
+}
+
+void read_file(seqt & s, const char * path) {
+    mapped_file file(path);
+    const char * next = file.data();
+    const char * const end = file.data() + file.size();
+
+    switch(s.alphabet_kind()) {
+    case alphabet::kind::code_points: {
+        utf8_decoder decoder(next, end);
+        read_blocks<wchar_t>(s, [&](wchar_t * block, size_t capacity) {
+            return decoder.decode(block, capacity);
+        });
+        break;
+    }
+    case alphabet::kind::bytes:
+        read_blocks<unsigned char>(s, [&](unsigned char * block, size_t capacity) {
+            size_t length = std::min<size_t>(capacity, end - next);
+            std::memcpy(block, next, length);
+            next += length;
+            return length;
+        });
+        break;
+    case alphabet::kind::tokens:
+        // decimal token ids separated by anything that isn't a digit
+        read_blocks<uint32_t>(s, [&](uint32_t * block, size_t capacity) {
+            size_t length = 0;
+            while(length < capacity && next < end) {
+                if(*next < '0' || *next > '9') {
+                    next++;
+                    continue;
+                }
+
+                uint64_t token = 0;
+                for(; next < end && *next >= '0' && *next <= '9'; next++) {
+                    token = token * 10 + (*next - '0');
+                    if(token > UINT32_MAX)
+                        throw std::out_of_range(std::string(path) + " has a token past 2^32");
+                }
+                block[length++] = (uint32_t)token;
+            }
+            return length;
+        });
+        break;
+    }
+}
+
 int main(int ac, char ** av)
 {
     init_locale();
 
-    wchar_t c;
-    wchar_t eof = std::char_traits<wchar_t>::eof();
+    // main [--cpu] [--profile] [--device-loop] [--specialize] [--alphabet code-points|bytes|tokens] [--load snapshot] [--save snapshot] [file]
+    seqt::backend backend = seqt::backend::opencl;
+    alphabet::kind symbols = alphabet::kind::code_points;
+    bool profiling = false;
+    bool device_loop = false;
+    bool specialize = false;
+    std::string load_path, save_path;
+
+    for(; ac > 1 && std::string(av[1]).rfind("--", 0) == 0; ac--, av++) {
+        std::string option = av[1];
+
+        bool known = true;
+
+        if(option == "--cpu") {
+            backend = seqt::backend::cpu;
+        } else if(option == "--profile") {
+            profiling = true;
+        } else if(option == "--device-loop") {
+            device_loop = true;
+        } else if(option == "--specialize") {
+            specialize = true;
+        } else if(option == "--alphabet" && ac > 2) {
+            known = false;
+            for(auto k : { alphabet::kind::code_points, alphabet::kind::bytes, alphabet::kind::tokens }) {
+                if(av[2] == std::string(alphabet::name(k))) {
+                    symbols = k;
+                    known = true;
+                }
+            }
+            ac--;
+            av++;
+        } else if((option == "--load" || option == "--save") && ac > 2) {
+            (option == "--load" ? load_path : save_path) = av[2];
+            ac--;
+            av++;
+        } else {
+            known = false;
+        }
 
-    seqt s;
+        if(!known) {
+            std::wcerr << "usage: main [--cpu] [--profile] [--device-loop] [--specialize] [--alphabet code-points|bytes|tokens] [--load snapshot] [--save snapshot] [file]" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // a loaded snapshot brings its own alphabet
+    seqt s(backend, symbols, profiling);
+    if(s._opencl)
+        s._opencl->_device_loop = device_loop;
+    if(specialize)
+        s.specialize();
+
+    if(!load_path.empty()) {
+        auto start = std::chrono::steady_clock::now();
+        s.load(load_path);
+        s._startup_time += std::chrono::steady_clock::now() - start;
+    }
+
+    wcout << "startup: " << std::chrono::duration<double, std::milli>(s._startup_time).count() << " ms"
+          << (s._opencl && s._opencl->_kernels_from_cache ? " (kernels from cache)" : "") << endl;
 
 #if USE_SIMPLE_DATA 
     std::string test = "abaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabababaababaababaababaababaabab";
@@ -88,26 +217,34 @@ int main(int ac, char ** av)
     }
 #endif
 
-    if(ac > 1) {    
-        wifstream f(av[1]);
-
-        for(int i = 0;; i++) {
-            c = f.get();
+    if(ac > 1)
+        read_file(s, av[1]);
 
-            s.read(c);
+    if(!save_path.empty())
+        s.save(save_path);
 
-            if(i % 10 == 0) {
-                wcout << ".";
-                wcout.flush();
-            }
+    s.print_all(wcout);
 
-            if(c == eof) 
-                break;
-        }
-        wcout << endl;
+    // the host engine never waits on anything
+    if(s._opencl) {
+        wcout << "host stall: " << std::chrono::duration<double, std::milli>(s._opencl->_stall_time).count() 
+              << " ms in " << s._opencl->_stall_count << " waits" << endl;
+        wcout << "scratch buffers created: " << s._opencl->_arena.buffers_created() << endl;
+    }
+    wcout << "active sequences: " << s.active_size() << endl;
+    if(s._opencl)
+        s._opencl->_dispatch.print(wcout);
+
+    fixpoint_stats const & f = s.fixpoint();
+    wcout << "fixpoint: " << f.passes_per_character() << " passes per character, frontier "
+          << f.mean_frontier() << " on average and " << f.frontier_max << " at most, "
+          << f.candidates << " candidates" << endl;
+
+    if(profiling) {
+        s.profile().print(wcout);
+        if(s._opencl)
+            s._opencl->_tuner.print(wcout);
     }
-
-    s.print_all(wcout);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "alphabet.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+alphabet::alphabet(kind k) :
+    _kind(k)
+{
+    switch(_kind) {
+    case kind::code_points:
+        _direct.resize(0x10000);
+        break;
+    case kind::bytes:
+        _direct.resize(256);
+        break;
+    case kind::tokens:
+        // grown to the largest token read
+        break;
+    }
+}
+
+alphabet::atom & alphabet::find_slow(uint32_t symbol) {
+    switch(_kind) {
+    case kind::code_points:
+        return _hashed[symbol];
+    case kind::bytes:
+        throw std::out_of_range("symbol " + std::to_string(symbol) + " isn't a byte");
+    case kind::tokens:
+        if(symbol >= max_direct_tokens)
+            return _hashed[symbol];
+        break;
+    }
+
+    // token ids are dense, so the table grows geometrically like the columns do
+    _direct.resize(std::min<size_t>(max_direct_tokens,
+        std::max<size_t>((size_t)symbol + 1, 2 * _direct.size())));
+    return _direct[symbol];
+}
+
+void alphabet::remap(std::vector<long> const & reverse_index) {
+    auto move = [&](atom & a) {
+        if(a.id == none)
+            return;
+
+        long rev = reverse_index[a.id];
+        if(rev == 0)
+            a = atom(); // forgetting this one, it gets a new atom if it shows up again
+        else
+            a.id = rev;
+    };
+
+    for(atom & a : _direct)
+        move(a);
+    for(auto & p : _hashed)
+        move(p.second);
+}
+
+std::vector<std::pair<uint32_t, alphabet::atom>> alphabet::atoms() const {
+    std::vector<std::pair<uint32_t, atom>> result;
+
+    for(uint32_t s = 0; s < _direct.size(); s++) {
+        if(_direct[s].id != none)
+            result.push_back({s, _direct[s]});
+    }
+
+    size_t direct_count = result.size();
+    for(auto const & p : _hashed) {
+        if(p.second.id != none)
+            result.push_back(p);
+    }
+    std::sort(result.begin() + direct_count, result.end(),
+        [](auto const & a, auto const & b) { return a.first < b.first; });
+
+    return result;
+}
+
+std::map<long, std::wstring> alphabet::text() const {
+    std::map<long, std::wstring> result;
+
+    for(auto const & p : atoms()) {
+        if(_kind == kind::tokens)
+            result[p.second.id] = L"<" + std::to_wstring(p.first) + L">";
+        else
+            result[p.second.id] = std::wstring(1, (wchar_t)p.first);
+    }
+
+    return result;
+}
+
+const char * alphabet::name(kind k) {
+    switch(k) {
+    case kind::code_points: return "code-points";
+    case kind::bytes: return "bytes";
+    case kind::tokens: return "tokens";
+    }
+    return "unknown";
+}
@@ -0,0 +1,139 @@
+#include "dispatcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <system_error>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// sizes calibrate tries, 1 to 65536
+const long calibration_sizes[] = { 1, 4, 16, 64, 256, 1024, 4096, 16384, 65536 };
+const int calibration_runs = 3;
+
+} // namespace
+
+dispatcher::dispatcher(std::string path) :
+    _path(std::move(path))
+{
+    if(_path.empty())
+        return;
+
+    // one "primitive threshold" a line, anything unreadable is calibrated again
+    std::ifstream f(_path);
+    std::string name;
+    long threshold;
+    while(f >> name >> threshold) {
+        if(threshold >= 0) {
+            _primitives[name].threshold = threshold;
+            _primitives[name].calibrated = true;
+        }
+    }
+}
+
+bool dispatcher::on_host(const char * name, long size) {
+    primitive & p = _primitives[name];
+
+    bool host = _force == side::host || (_force == side::automatic && size <= p.threshold);
+    if(host) {
+        p.host_calls++;
+        p.host_elements += size;
+    } else {
+        p.device_calls++;
+        p.device_elements += size;
+    }
+
+    return host;
+}
+
+void dispatcher::calibrate(const char * name, std::function<void(long)> setup, std::function<void(long)> run) {
+    side force = _force;
+
+    // the fastest of a few runs, the first one also builds whatever the device side needs
+    auto time = [&](side s, long size) {
+        _force = s;
+        double fastest = std::numeric_limits<double>::max();
+        for(int i = 0; i <= calibration_runs; i++) {
+            setup(size);
+            auto start = std::chrono::steady_clock::now();
+            run(size);
+            std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+            if(i > 0)
+                fastest = std::min(fastest, seconds.count());
+        }
+        return fastest;
+    };
+
+    long threshold = 0;
+    for(long size : calibration_sizes) {
+        if(time(side::host, size) > time(side::device, size))
+            break;
+        threshold = size;
+    }
+
+    _force = force;
+    _primitives[name] = primitive();
+    _primitives[name].threshold = threshold;
+    _primitives[name].calibrated = true;
+}
+
+bool dispatcher::calibrated(const char * name) const {
+    auto p = _primitives.find(name);
+    return p != _primitives.end() && p->second.calibrated;
+}
+
+void dispatcher::save() const {
+    if(_path.empty())
+        return;
+
+    // only an optimization like the kernel cache, so failing to write it isn't an error
+    std::error_code ec;
+    fs::create_directories(fs::path(_path).parent_path(), ec);
+    if(ec)
+        return;
+
+    std::string tmp = _path + "." + std::to_string(::getpid()) + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::trunc);
+        if(!f)
+            return;
+
+        for(auto const & p : _primitives) {
+            if(p.second.calibrated)
+                f << p.first << " " << p.second.threshold << "\n";
+        }
+        if(!f) {
+            f.close();
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+
+    fs::rename(tmp, _path, ec);
+    if(ec)
+        fs::remove(tmp, ec);
+}
+
+void dispatcher::clear() {
+    for(auto & p : _primitives) {
+        primitive calibrated;
+        calibrated.threshold = p.second.threshold;
+        calibrated.calibrated = p.second.calibrated;
+        p.second = calibrated;
+    }
+}
+
+void dispatcher::print(std::wostream & os) const {
+    for(auto const & p : _primitives) {
+        primitive const & s = p.second;
+        os << "dispatch: " << std::wstring(p.first.begin(), p.first.end())
+           << " on the host up to " << s.threshold << " elements, "
+           << s.host_calls << " calls on the host and " << s.device_calls << " on the device" << std::endl;
+    }
+}
@@ -0,0 +1,126 @@
+#include "kernel_cache.hpp"
+
+#include <boost/compute/detail/sha1.hpp>
+#include <boost/compute/exception/opencl_error.hpp>
+#include <boost/compute/platform.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#include <unistd.h>
+
+using namespace boost::compute;
+
+namespace fs = std::filesystem;
+
+kernel_cache::kernel_cache(std::string directory) :
+    _directory(std::move(directory)),
+    _last_was_hit(false)
+{ }
+
+std::string kernel_cache::default_directory() {
+    if(const char * dir = std::getenv("SEQT_CACHE_DIR"))
+        return dir;
+    if(const char * xdg = std::getenv("XDG_CACHE_HOME"))
+        return (fs::path(xdg) / "seqt").string();
+    if(const char * home = std::getenv("HOME"))
+        return (fs::path(home) / ".cache" / "seqt").string();
+
+    // nowhere to put them, every run compiles
+    return std::string();
+}
+
+program kernel_cache::build(std::string const & source, context const & ctx, std::string const & options) {
+    device dev = ctx.get_device();
+    std::string path;
+
+    _last_was_hit = false;
+
+    if(!_directory.empty()) {
+        path = (fs::path(_directory) / (key(source, dev, options) + ".bin")).string();
+
+        std::vector<unsigned char> binary;
+        if(load(path, binary)) {
+            try {
+                program p = program::create_with_binary(binary, ctx);
+                p.build(options);
+
+                _last_was_hit = true;
+                return p;
+            } catch(opencl_error const &) {
+                // a truncated or foreign binary, compile it again and overwrite it
+            }
+        }
+    }
+
+    program p = program::create_with_source(source, ctx);
+    p.build(options);
+
+    if(!path.empty())
+        store(path, p.binary());
+
+    return p;
+}
+
+std::string kernel_cache::profile_path(std::string const & source, context const & ctx, std::string const & options,
+    std::string const & extension) const
+{
+    if(_directory.empty())
+        return std::string();
+
+    return (fs::path(_directory) / (key(source, ctx.get_device(), options) + extension)).string();
+}
+
+std::string kernel_cache::key(std::string const & source, device const & dev, std::string const & options) const {
+    detail::sha1 hash;
+
+    hash.process(dev.platform().name())
+        .process(dev.platform().version())
+        .process(dev.vendor())
+        .process(dev.name())
+        .process(dev.version())
+        .process(dev.driver_version())
+        .process(options)
+        .process(source);
+
+    return hash;
+}
+
+bool kernel_cache::load(std::string const & path, std::vector<unsigned char> & binary) const {
+    std::ifstream f(path, std::ios::binary);
+    if(!f)
+        return false;
+
+    binary.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return !binary.empty();
+}
+
+void kernel_cache::store(std::string const & path, std::vector<unsigned char> const & binary) const {
+    // the cache is only an optimization, so failing to write it isn't an error
+    std::error_code ec;
+    fs::create_directories(_directory, ec);
+    if(ec || binary.empty())
+        return;
+
+    // write next to the final name and rename, so concurrent runs never see half a file
+    std::string tmp = path + "." + std::to_string(::getpid()) + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if(!f)
+            return;
+
+        f.write(reinterpret_cast<const char *>(binary.data()), binary.size());
+        if(!f) {
+            f.close();
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+
+    fs::rename(tmp, path, ec);
+    if(ec)
+        fs::remove(tmp, ec);
+}
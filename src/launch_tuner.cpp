@@ -0,0 +1,171 @@
+#include "launch_tuner.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#include <unistd.h>
+
+using namespace boost::compute;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// past 2^20 work items the local size doesn't change what's best any more
+const int largest_bucket = 20;
+
+// every candidate is timed this many times and the fastest run kept
+const int runs_per_candidate = 3;
+
+} // namespace
+
+launch_tuner::launch_tuner(device const & dev, std::string path) :
+    _device(dev),
+    _path(std::move(path))
+{
+    if(_path.empty())
+        return;
+
+    // one "kernel bucket local_size" a line, anything unreadable is tuned again
+    std::ifstream f(_path);
+    std::string name;
+    int b;
+    long size;
+    while(f >> name >> b >> size) {
+        if(size > 0)
+            _profile[{ name, b }] = size;
+    }
+}
+
+int launch_tuner::bucket_of(long global_size) {
+    int b = 0;
+    while(b < largest_bucket && (1L << b) < global_size)
+        b++;
+    return b;
+}
+
+launch_tuner::entry & launch_tuner::find(kernel & k) {
+    auto i = _kernels.find(k.get());
+    if(i != _kernels.end())
+        return i->second;
+
+    // the only queries, once a kernel
+    entry & e = _kernels[k.get()];
+    e.name = k.name();
+    e.max_size = k.get_work_group_info<long>(_device, CL_KERNEL_WORK_GROUP_SIZE);
+    e.multiple = std::max<long>(1, k.get_work_group_info<long>(_device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE));
+    return e;
+}
+
+launch_tuner::bucket & launch_tuner::find(entry & e, long global_size) {
+    int b = bucket_of(global_size);
+
+    auto i = e.buckets.find(b);
+    if(i != e.buckets.end())
+        return i->second;
+
+    bucket & t = e.buckets[b];
+
+    // a local size past the top of the bucket only adds idle work items, so
+    // with the global size rounded up to it a launch stays in its bucket
+    long top = std::min(1L << b, e.max_size);
+    for(long size = std::min(e.multiple, top); size <= top; size *= 2)
+        t.candidates.push_back(size);
+    if(t.candidates.empty())
+        t.candidates.push_back(1);
+
+    auto loaded = _profile.find({ e.name, b });
+    if(loaded != _profile.end() && loaded->second <= e.max_size)
+        t.local_size = loaded->second;
+    else if(t.candidates.size() == 1)
+        t.local_size = t.candidates.front();
+
+    return t;
+}
+
+long launch_tuner::local_size(kernel & k, long global_size) {
+    bucket & t = find(find(k), global_size);
+    if(t.local_size)
+        return t.local_size;
+    return _sweep ? t.candidates[t.next] : t.candidates.back();
+}
+
+bool launch_tuner::sweeping(kernel & k, long global_size) {
+    return _sweep && find(find(k), global_size).local_size == 0;
+}
+
+void launch_tuner::merge(launch_tuner const & other) {
+    for(auto const & p : other._profile)
+        _profile.insert(p);
+
+    // and the buckets launched into before there was a size for them
+    for(auto & k : _kernels) {
+        for(auto & b : k.second.buckets) {
+            auto loaded = _profile.find({ k.second.name, b.first });
+            if(!b.second.local_size && loaded != _profile.end() && loaded->second <= k.second.max_size)
+                b.second.local_size = loaded->second;
+        }
+    }
+}
+
+void launch_tuner::measured(kernel & k, long global_size, long local_size, double seconds) {
+    entry & e = find(k);
+    bucket & t = find(e, global_size);
+    if(!_sweep || t.local_size || t.candidates[t.next] != local_size)
+        return;
+
+    if(seconds < t.best_seconds) {
+        t.best_seconds = seconds;
+        t.best = local_size;
+    }
+
+    if(++t.runs < runs_per_candidate)
+        return;
+
+    t.runs = 0;
+    if(++t.next < t.candidates.size())
+        return;
+
+    t.local_size = t.best;
+    _profile[{ e.name, bucket_of(global_size) }] = t.best;
+    save();
+}
+
+void launch_tuner::save() const {
+    if(_path.empty())
+        return;
+
+    // like the kernel cache this is only an optimization, so failing to write it isn't an error
+    std::error_code ec;
+    fs::create_directories(fs::path(_path).parent_path(), ec);
+    if(ec)
+        return;
+
+    std::string tmp = _path + "." + std::to_string(::getpid()) + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::trunc);
+        if(!f)
+            return;
+
+        for(auto const & p : _profile)
+            f << p.first.first << " " << p.first.second << " " << p.second << "\n";
+        if(!f) {
+            f.close();
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+
+    fs::rename(tmp, _path, ec);
+    if(ec)
+        fs::remove(tmp, ec);
+}
+
+void launch_tuner::print(std::wostream & os) const {
+    for(auto const & p : _profile) {
+        os << "local size: " << std::wstring(p.first.first.begin(), p.first.first.end())
+           << " up to " << (1L << p.first.second) << " work items: " << p.second << std::endl;
+    }
+}
@@ -0,0 +1,76 @@
+#include "mapped_file.hpp"
+
+#include <cerrno>
+#include <fstream>
+#include <system_error>
+
+#if !_WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if _WIN32
+
+mapped_file::mapped_file(std::string const & path) :
+    _data(nullptr),
+    _size(0)
+{
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if(!f)
+        throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path);
+
+    _contents.resize((size_t)f.tellg());
+    f.seekg(0);
+    f.read(_contents.data(), _contents.size());
+
+    _data = _contents.data();
+    _size = _contents.size();
+}
+
+mapped_file::~mapped_file() { }
+
+#else
+
+mapped_file::mapped_file(std::string const & path) :
+    _data(nullptr),
+    _size(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw std::system_error(errno, std::generic_category(), path);
+
+    struct stat st;
+    if(::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), path);
+    }
+
+    _size = st.st_size;
+
+    // mmap of an empty file fails, and there is nothing to read anyway
+    if(_size > 0) {
+        void * p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), path);
+        }
+
+        // the file is read front to back exactly once
+        ::madvise(p, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char *>(p);
+    }
+
+    // the mapping keeps the file alive
+    ::close(fd);
+}
+
+mapped_file::~mapped_file() {
+    if(_data)
+        ::munmap(const_cast<char *>(_data), _size);
+}
+
+#endif
@@ -0,0 +1,159 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace boost::compute;
+
+namespace {
+
+double to_ms(cl_ulong nanoseconds) {
+    return nanoseconds / 1e6;
+}
+
+// nearest rank percentile of sorted samples
+double percentile(std::vector<double> const & sorted, double p) {
+    if(sorted.empty())
+        return 0;
+
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+} // namespace
+
+profiler::stage::stage(profiler * p, const char * name) :
+    _p(p),
+    _name(name)
+{
+    if(!_p)
+        return;
+
+    if(_p->_queue)
+        _begin = _p->_queue->enqueue_marker();
+    else
+        _start = std::chrono::steady_clock::now();
+}
+
+profiler::stage::~stage() {
+    if(!_p)
+        return;
+
+    if(_p->_queue) {
+        _p->_pending_stages.push_back({ _name, _begin, _p->_queue->enqueue_marker() });
+    } else {
+        std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - _start;
+        _p->_stages[_name].ms.push_back(ms.count());
+    }
+}
+
+profiler::profiler(command_queue * queue) :
+    _queue(queue)
+{ }
+
+void profiler::kernel(std::string const & name, event const & e) {
+    _pending_kernels.push_back({ name, e });
+}
+
+void profiler::host(const char * name, std::chrono::nanoseconds time) {
+    _host[name].ms.push_back(std::chrono::duration<double, std::milli>(time).count());
+}
+
+void profiler::collect() {
+    // a marker ends once everything before it has, so the time between two
+    // markers is the time the device spent on what was enqueued between them
+    for(pending_stage const & s : _pending_stages) {
+        cl_ulong begin = s.begin.get_profiling_info<cl_ulong>(CL_PROFILING_COMMAND_END);
+        cl_ulong end = s.end.get_profiling_info<cl_ulong>(CL_PROFILING_COMMAND_END);
+        _stages[s.name].ms.push_back(to_ms(end - begin));
+    }
+    _pending_stages.clear();
+
+    for(pending_kernel const & k : _pending_kernels) {
+        cl_ulong queued = k.e.get_profiling_info<cl_ulong>(CL_PROFILING_COMMAND_QUEUED);
+        cl_ulong start = k.e.get_profiling_info<cl_ulong>(CL_PROFILING_COMMAND_START);
+        cl_ulong end = k.e.get_profiling_info<cl_ulong>(CL_PROFILING_COMMAND_END);
+
+        samples & s = _kernels[k.name];
+        s.ms.push_back(to_ms(end - start));
+        s.waiting_ms += to_ms(start - queued);
+    }
+    _pending_kernels.clear();
+}
+
+std::vector<profiler::stats> profiler::summarize(std::map<std::string, samples> const & all) {
+    std::vector<stats> result;
+
+    for(auto const & p : all) {
+        std::vector<double> sorted = p.second.ms;
+        std::sort(sorted.begin(), sorted.end());
+
+        stats s;
+        s.name = p.first;
+        s.count = sorted.size();
+        s.total_ms = 0;
+        for(double ms : sorted)
+            s.total_ms += ms;
+        s.p50_ms = percentile(sorted, .5);
+        s.p90_ms = percentile(sorted, .9);
+        s.p99_ms = percentile(sorted, .99);
+        s.max_ms = sorted.empty() ? 0 : sorted.back();
+        s.waiting_ms = p.second.waiting_ms;
+        result.push_back(s);
+    }
+
+    // biggest first
+    std::sort(result.begin(), result.end(), [](stats const & a, stats const & b) {
+        return a.total_ms > b.total_ms;
+    });
+
+    return result;
+}
+
+profiler::report profiler::get_report() const {
+    report r;
+    r.stages = summarize(_stages);
+    r.kernels = summarize(_kernels);
+    r.host = summarize(_host);
+    return r;
+}
+
+void profiler::clear() {
+    _pending_stages.clear();
+    _pending_kernels.clear();
+    _stages.clear();
+    _kernels.clear();
+    _host.clear();
+}
+
+void profiler::report::print(std::wostream & os) const {
+    auto table = [&](const wchar_t * title, std::vector<stats> const & rows, bool waiting) {
+        if(rows.empty())
+            return;
+
+        os << title << " (ms)\n";
+        os << std::setw(28) << std::left << L"name" << std::right
+           << std::setw(10) << L"count" << std::setw(12) << L"total"
+           << std::setw(10) << L"p50" << std::setw(10) << L"p90"
+           << std::setw(10) << L"p99" << std::setw(10) << L"max";
+        if(waiting)
+            os << std::setw(12) << L"waiting";
+        os << "\n";
+
+        for(stats const & s : rows) {
+            os << std::setw(28) << std::left << std::wstring(s.name.begin(), s.name.end()) << std::right
+               << std::setw(10) << s.count << std::fixed << std::setprecision(3)
+               << std::setw(12) << s.total_ms
+               << std::setw(10) << s.p50_ms << std::setw(10) << s.p90_ms
+               << std::setw(10) << s.p99_ms << std::setw(10) << s.max_ms;
+            if(waiting)
+                os << std::setw(12) << s.waiting_ms;
+            os << std::defaultfloat << "\n";
+        }
+    };
+
+    table(L"stages", stages, false);
+    table(L"kernels", kernels, true);
+    table(L"host", host, false);
+}
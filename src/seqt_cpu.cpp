@@ -0,0 +1,772 @@
+#include "seqt_cpu.hpp"
+#include "snapshot.hpp"
+#include "sequence_text.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <limits>
+
+using std::endl;
+
+namespace {
+
+using boost::compute::long2_;
+
+// lexicographic (s0, s1) order, same as long2_compare on the device
+bool pair_less(long2_ const & a, long2_ const & b) {
+    if(a.x < b.x) return true;
+    if(b.x < a.x) return false;
+    return a.y < b.y;
+}
+
+// ascending significance with NaN's sorted to the end
+bool significance_less(float a, float b) {
+    if(std::isnan(a)) return false;
+    if(std::isnan(b)) return true;
+    return a < b;
+}
+
+} // namespace
+
+
+long seqt_cpu::get_char_index(uint32_t symbol) {
+    alphabet::atom & a = _alphabet[symbol];
+    if(a.seen)
+        return a.id;
+
+    if(a.id == alphabet::none) {
+        // this will mark it as completing here
+        a.id = add_atoms(1, _characters_read);
+    } else {
+        // created up front, it is tracked from its first sight like any other atom
+        _initial_characters_read[a.id] = _characters_read;
+        _last_completed[a.id] = _characters_read;
+    }
+
+    a.seen = true;
+    return a.id;
+}
+
+long seqt_cpu::add_atoms(long count, long last_completed) {
+    long first = _total;
+    _total += count;
+
+    _initial_characters_read.resize(_total, _characters_read);
+    _lengths.resize(_total, 1);
+
+    // atoms have prev[i] and next[i] == 0
+    _seqs.resize(_total, long2_(0,0));
+    _initial_seq_counts.resize(_total, long2_(0,0));
+
+    _counts.resize(_total, 0); // initialize count to zero because we haven't tracked this yet
+    _last_completed.resize(_total, last_completed);
+
+    return first;
+}
+
+template<typename Symbol>
+void seqt_cpu::read_symbols(const Symbol * data, size_t length) {
+    auto start = std::chrono::steady_clock::now();
+
+    for(size_t i = 0; i < length; i++)
+        read_char(data[i]);
+
+    // bring the significance of the whole table up to date once per block
+    _stats_characters_read = _characters_read;
+    {
+        profiler::stage stage(_profiler.get(), "stats");
+        calculate_stats();
+    }
+
+    if(_profiler)
+        _profiler->host("read", std::chrono::steady_clock::now() - start);
+}
+
+void seqt_cpu::read(const wchar_t * data, size_t length) {
+    read_symbols(data, length);
+}
+
+void seqt_cpu::read(const unsigned char * data, size_t length) {
+    read_symbols(data, length);
+}
+
+void seqt_cpu::read(const uint32_t * data, size_t length) {
+    read_symbols(data, length);
+}
+
+void seqt_cpu::read_char(uint32_t symbol) {
+    std::vector<long> current;
+    std::vector<long> frontier;
+    std::vector<long> scratch;
+    std::vector<long> existing_indices;
+    std::vector<long> new_find_indices;
+    std::vector<long2_> found;
+    std::vector<long2_> new_finds;
+    // candidates that didn't become sequences, and the statistics they were judged against
+    std::vector<long2_> passed_over;
+    long passed_over_judged_at;
+
+    // sequences are as far behind as their _last_completed is from this position
+    _position = _characters_read;
+
+    // get the index of the current char
+    // this will mark it as completing here if it's new
+    long index;
+    {
+        profiler::stage stage(_profiler.get(), "atoms");
+        index = get_char_index(symbol);
+    }
+    // significance is worked out on demand from the counts as they are now
+    _stats_characters_read = _characters_read;
+    _characters_read++;
+    passed_over_judged_at = _stats_characters_read;
+
+    // flag our current sequences
+    std::vector<long> current_flag(_total);
+    {
+        profiler::stage stage(_profiler.get(), "flag_current");
+        _pool.parallel_for(_total, [&](long begin, long end) {
+            for(long i = begin; i < end; i++)
+                current_flag[i] = _last_completed[i] == _position;
+        });
+
+        // manually set the current flag to 1 for the index of
+        // the current char
+        current_flag[index] = 1;
+
+        // the first frontier is everything current, after that it is only what
+        // became current on the pass before.  a candidate ending in an older
+        // current sequence was already looked at on an earlier pass
+        frontier = pack(current_flag, [](long x) { return x == 1; });
+    }
+    _fixpoint.characters++;
+
+    bool do_remove_least_significant = false;
+
+    while(frontier.size() > 0) {
+        _fixpoint.add_pass(frontier.size());
+
+        // create a list of pairs of potential sequences based on the length
+        {
+            profiler::stage stage(_profiler.get(), "find_nexts");
+            found = find_nexts_by_length(frontier);
+        }
+        _fixpoint.candidates += found.size();
+
+        {
+            profiler::stage stage(_profiler.get(), "mark_exists");
+
+            // mark the indices in scratch for new ones with a 0, mark the found sequence for found ones
+            scratch.resize(found.size());
+            mark_exists(found, scratch);
+
+            // Collect all the new sequences and add them to our list to be tracked
+            new_find_indices = pack(scratch, [](long x) { return x == 0; });
+        }
+
+        long first_new = _total;
+
+        // what was passed over earlier in this character still counts against the table
+        long tracked = _total + (long)new_find_indices.size() + (long)passed_over.size();
+        if(tracked > _max_sequences_tracked) {
+            do_remove_least_significant = true;
+            for(long i : new_find_indices)
+                passed_over.push_back(found[i]);
+        } else {
+            profiler::stage stage(_profiler.get(), "new_finds");
+
+            new_finds.resize(new_find_indices.size());
+            for(size_t i = 0; i < new_find_indices.size(); i++)
+                new_finds[i] = found[new_find_indices[i]];
+
+            // adding sequences moves the statistics on, so whatever was
+            // passed over before that has to be judged again
+            if(passed_over_judged_at != _stats_characters_read) {
+                new_finds.insert(new_finds.end(), passed_over.begin(), passed_over.end());
+                passed_over.clear();
+            }
+            passed_over_judged_at = _stats_characters_read;
+
+            // new sequences get their ids in (prev, next) order
+            {
+                profiler::stage stage(_profiler.get(), "sort");
+                std::sort(new_finds.begin(), new_finds.end(), pair_less);
+            }
+
+            process_new_finds(new_finds, current_flag, passed_over);
+        }
+
+        {
+            profiler::stage stage(_profiler.get(), "flag_existing");
+
+            // the non-zero entries of scratch are the indices of the existing sequences
+            existing_indices.clear();
+            std::copy_if(scratch.begin(), scratch.end(), std::back_inserter(existing_indices), [](long x) { return x != 0; });
+
+            // the next frontier is every sequence added or flagged on this pass
+            frontier.resize(_total - first_new);
+            std::iota(frontier.begin(), frontier.end(), first_new);
+            flag_existing(existing_indices, current_flag, frontier);
+        }
+    }
+
+    if(do_remove_least_significant) {
+        // pruning ranks the whole table, so it needs every significance from before the counts change
+        profiler::stage stage(_profiler.get(), "prune");
+        calculate_stats();
+    }
+
+    {
+        profiler::stage stage(_profiler.get(), "counts");
+        current = pack(current_flag, [](long x) { return x == 1; });
+
+        // increment counts for all the current sequences, and mark them as completing at this position
+        increment_counts(current);
+    }
+
+    {
+        profiler::stage stage(_profiler.get(), "active");
+        update_active(current, current_flag);
+    }
+
+    if(do_remove_least_significant) {
+        profiler::stage stage(_profiler.get(), "prune");
+        remove_least_significant(_total / 2);
+    }
+}
+
+long seqt_cpu::process_new_finds(std::vector<long2_> const & finds, std::vector<long> & current_flag, std::vector<long2_> & passed_over) {
+    if(finds.size() == 0)
+        return 0;
+
+    std::vector<long> scratch(finds.size());
+    is_sequence_significant(finds, _sigma, _min_occurances, scratch);
+
+    // the ones that aren't significant are kept in case the statistics change
+    for(size_t i = 0; i < finds.size(); i++) {
+        if(scratch[i] == 0)
+            passed_over.push_back(finds[i]);
+    }
+
+    // is it both significant and new?
+    std::vector<long> new_find_indices = pack(scratch, [](long x) { return x == 1; });
+    long new_count = new_find_indices.size();
+
+    if(new_count > 0) {
+        add_new_finds(new_find_indices, finds, _position);
+        _stats_characters_read = _characters_read;
+
+        // all new sequences are flaged as current
+        current_flag.resize(_total, 1);
+    }
+
+    return new_count;
+}
+
+long seqt_cpu::flag_existing(std::vector<long> const & existing_indices, std::vector<long> & current_flag, std::vector<long> & newly_flagged) {
+    long count = 0;
+
+    for(long i : existing_indices) {
+        if(current_flag[i])
+            continue;
+
+        current_flag[i] = 1;
+        newly_flagged.push_back(i);
+        count++;
+    }
+
+    return count;
+}
+
+void seqt_cpu::rebuild_active(long since) {
+    _active = pack(_last_completed, [&](long x) { return x >= since; });
+    _active_since = since;
+}
+
+void seqt_cpu::update_active(std::vector<long> const & current, std::vector<long> const & current_flag) {
+    // what the next character can reach back to
+    long since = _position + 1 - _max_length;
+    if(_active_since > since) {
+        rebuild_active(since);
+        return;
+    }
+
+    // keep what is still in reach, dropping the current ones so they aren't listed twice
+    auto end = std::remove_if(_active.begin(), _active.end(), [&](long id) {
+        return current_flag[id] || _last_completed[id] < since;
+    });
+    _active.erase(end, _active.end());
+
+    // then add everything that completed on this character
+    _active.insert(_active.end(), current.begin(), current.end());
+    _active_since = since;
+}
+
+std::vector<seqt_cpu::long2_> seqt_cpu::find_nexts_by_length(std::vector<long> & current) {
+    std::vector<long2_> found;
+
+    // STEP 1: sort all current sequences by length
+    std::stable_sort(current.begin(), current.end(), [&](long a, long b) {
+        return _lengths[a] < _lengths[b];
+    });
+
+    std::vector<long> current_lengths(current.size());
+    for(size_t i = 0; i < current.size(); i++)
+        current_lengths[i] = _lengths[current[i]];
+
+    // only the sequences that completed within the longest length of this one can come right before a current one
+    if(_active_since > _position - _max_length)
+        rebuild_active(_position - _max_length);
+
+    // STEP 2: current[nexts[i].s0 ... nexts[i].s1) are all the potential nexts for active sequence i
+    std::vector<long2_> nexts(_active.size());
+    std::vector<long> scratch(_active.size());
+    find_nexts(current_lengths, nexts, scratch);
+
+    // STEP 3: Tally up all our new potential sequences so we can enumerate them
+    std::inclusive_scan(scratch.begin(), scratch.end(), scratch.begin());
+
+    long found_count = scratch.back();
+    if(found_count == 0)
+        return found;
+
+    // STEP 4: Enumerate all potential new sequences
+    found.resize(found_count);
+    collect_finds(nexts, scratch, current, found);
+
+    return found;
+}
+
+long seqt_cpu::add_new_finds(std::vector<long> const & new_find_indices, std::vector<long2_> const & found, long completed_at) {
+    long new_total = _total + new_find_indices.size();
+
+    // grow our vectors
+    _lengths.resize(new_total);
+    _seqs.resize(new_total);
+    _initial_seq_counts.resize(new_total);
+    _last_completed.resize(new_total);
+    _counts.resize(new_total);
+    _initial_characters_read.resize(new_total, _characters_read);
+
+    // initialize the new ones
+    initialize_newly_found_sequences(new_find_indices, found, completed_at);
+    index_pairs(_total, new_total);
+
+    // the active list has to reach back as far as the longest sequence
+    for(long i = _total; i < new_total; i++)
+        _max_length = std::max(_max_length, _lengths[i]);
+
+    // update our total
+    _total = new_total;
+
+    return new_find_indices.size();
+}
+
+void seqt_cpu::remove_least_significant(long max_sequences) {
+    long to_remove = _total - max_sequences;
+    if(to_remove <= 0)
+        return;
+
+    // select the least significant of every sequence but the null sequence,
+    // ties go to the lower index so this matches a stable sort
+    std::vector<long> dex(_total - 1);
+    std::iota(dex.begin(), dex.end(), 1);
+    std::nth_element(dex.begin(), dex.begin() + to_remove, dex.end(), [&](long a, long b) {
+        if(significance_less(_significance[a], _significance[b])) return true;
+        if(significance_less(_significance[b], _significance[a])) return false;
+        return a < b;
+    });
+
+    // flag all the least significant
+    std::vector<long> flagged(_total, 0);
+    scatter_value(std::vector<long>(dex.begin(), dex.begin() + to_remove), 1, flagged);
+
+    // everything made from a flagged sequence has to go too
+    close_over_flagged(flagged);
+
+    std::vector<long> keep_index = pack(flagged, [](long x) { return x == 0; });
+
+    recreate_from_map(keep_index);
+}
+
+void seqt_cpu::recreate_from_map(std::vector<long> const & index) {
+    long index_size = index.size();
+
+    // reverse_index[i] is the location of sequence `i` in our new arrays,
+    // any data to be removed will be marked with 0
+    std::vector<long> reverse_index(_total, 0);
+    for(long i = 0; i < index_size; i++)
+        reverse_index[index[i]] = i;
+
+    auto gather_column = [&](auto & column) {
+        std::remove_reference_t<decltype(column)> gathered;
+        gathered.reserve(column.capacity());
+        gathered.resize(index_size);
+        _pool.parallel_for(index_size, [&](long begin, long end) {
+            #pragma omp simd
+            for(long i = begin; i < end; i++)
+                gathered[i] = column[index[i]];
+        });
+        column.swap(gathered);
+    };
+
+    gather_column(_counts);
+    gather_column(_lengths);
+    gather_column(_initial_seq_counts);
+    gather_column(_initial_characters_read);
+    gather_column(_expected_counts);
+    gather_column(_stddev_counts);
+    gather_column(_significance);
+    gather_column(_last_completed);
+
+    // carefully rewrite the seqs
+    std::vector<long2_> new_seqs;
+    new_seqs.reserve(_seqs.capacity());
+    new_seqs.resize(index_size);
+    gather_seqs(index, reverse_index, new_seqs);
+    _seqs.swap(new_seqs);
+
+    // and finally shrink our total
+    _total = index_size;
+
+    // every id has moved
+    _pair_index.clear();
+    index_pairs(0, _total);
+    rebuild_active(_active_since);
+
+    // and the atoms
+    _alphabet.remap(reverse_index);
+}
+
+void seqt_cpu::reserve(long capacity) {
+    _counts.reserve(capacity);
+    _lengths.reserve(capacity);
+    _seqs.reserve(capacity);
+    _initial_seq_counts.reserve(capacity);
+    _initial_characters_read.reserve(capacity);
+    _last_completed.reserve(capacity);
+    _expected_counts.reserve(capacity);
+    _stddev_counts.reserve(capacity);
+    _significance.reserve(capacity);
+    _pair_index.reserve(capacity);
+}
+
+void seqt_cpu::shrink_to_fit() {
+    _counts.shrink_to_fit();
+    _lengths.shrink_to_fit();
+    _seqs.shrink_to_fit();
+    _initial_seq_counts.shrink_to_fit();
+    _initial_characters_read.shrink_to_fit();
+    _last_completed.shrink_to_fit();
+    _expected_counts.shrink_to_fit();
+    _stddev_counts.shrink_to_fit();
+    _significance.shrink_to_fit();
+}
+
+void seqt_cpu::scatter_value(std::vector<long> const & indices, long value, std::vector<long> & output) {
+    _pool.parallel_for(indices.size(), [&](long begin, long end) {
+        // the indices are distinct, so the stores can't collide
+        #pragma omp simd
+        for(long gid = begin; gid < end; gid++)
+            output[indices[gid]] = value;
+    });
+}
+
+void seqt_cpu::increment_counts(std::vector<long> const & current) {
+    _pool.parallel_for(current.size(), [&](long begin, long end) {
+        for(long gid = begin; gid < end; gid++) {
+            long id = current[gid];
+            _counts[id]++;
+            _last_completed[id] = _position;
+        }
+    });
+}
+
+void seqt_cpu::find_nexts(std::vector<long> const & sorted_lengths, std::vector<long2_> & nexts, std::vector<long> & next_counts) {
+    _pool.parallel_for(_active.size(), [&](long begin, long end) {
+        for(long gid = begin; gid < end; gid++) {
+            // is the previous one behind by the length of the current ones?
+            long search_length = _position - _last_completed[_active[gid]];
+
+            auto range = std::equal_range(sorted_lengths.begin(), sorted_lengths.end(), search_length);
+            nexts[gid].x = range.first - sorted_lengths.begin();
+            nexts[gid].y = range.second - sorted_lengths.begin();
+            next_counts[gid] = nexts[gid].y - nexts[gid].x;
+        }
+    });
+}
+
+void seqt_cpu::collect_finds(std::vector<long2_> const & nexts, std::vector<long> const & scratch, std::vector<long> const & current, std::vector<long2_> & found) {
+    _pool.parallel_for(found.size(), [&](long begin, long end) {
+        for(long gid = begin; gid < end; gid++) {
+            // scratch is an inclusive scan of the number of nexts of each sequence
+            long prev = std::upper_bound(scratch.begin(), scratch.end(), gid) - scratch.begin();
+
+            long first_find = 0;
+            if(prev > 0)
+                first_find = scratch[prev-1];
+
+            found[gid].x = _active[prev];
+            found[gid].y = current[nexts[prev].x + gid - first_find];
+        }
+    });
+}
+
+void seqt_cpu::mark_exists(std::vector<long2_> const & found, std::vector<long> & scratch) {
+    _pool.parallel_for(found.size(), [&](long begin, long end) {
+        for(long gid = begin; gid < end; gid++) {
+            // scratch gets the id of the existing sequence for this find, or 0 if it's new
+            auto i = _pair_index.find(found[gid]);
+            scratch[gid] = i == _pair_index.end() ? 0 : i->second;
+        }
+    });
+}
+
+void seqt_cpu::index_pairs(long first, long last) {
+    for(long i = first; i < last; i++) {
+        // atoms (and the null sequence) aren't pairs
+        if(_seqs[i].x == 0 && _seqs[i].y == 0)
+            continue;
+
+        _pair_index[_seqs[i]] = i;
+    }
+}
+
+size_t seqt_cpu::pair_hash::operator()(long2_ const & p) const {
+    size_t h = (size_t)p.x * 0x9E3779B97F4A7C15UL + (size_t)p.y;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9UL;
+    return h ^ (h >> 32);
+}
+
+void seqt_cpu::initialize_newly_found_sequences(std::vector<long> const & new_find_indices, std::vector<long2_> const & found, long completed_at) {
+    _pool.parallel_for(new_find_indices.size(), [&](long begin, long end) {
+        for(long gid = begin; gid < end; gid++) {
+            long2_ s = found[new_find_indices[gid]];
+
+            long new_index = _total + gid;
+            _lengths[new_index] = _lengths[s.x] + _lengths[s.y];
+            _seqs[new_index] = s;
+            _counts[new_index] = 0;
+            _initial_seq_counts[new_index] = long2_(_counts[s.x], _counts[s.y]);
+            _last_completed[new_index] = completed_at;
+        }
+    });
+}
+
+// every value is computed and the right one picked at the end, there are no early
+// returns so the loops in calculate_stats and is_sequence_significant vectorize
+float seqt_cpu::sequence_stats(long i, long characters_read, float & expected_count, float & stddev_count) const {
+    // the halves one at a time, copying the whole long2_ is a 128 bit load that doesn't vectorize
+    long x = _seqs[i].x;
+    long y = _seqs[i].y;
+    float count = (float)_counts[i];
+
+    // how many a's and b's have we seen since we started tracking ab?
+    long a = _counts[x] - _initial_seq_counts[i].x;
+    long b = _counts[y] - _initial_seq_counts[i].y;
+
+    long a_len = _lengths[x];
+    long b_len = _lengths[y];
+    long min_initial = std::min(_initial_characters_read[x], _initial_characters_read[y]);
+    float characters_since = (float)(characters_read - min_initial);
+
+    float characters_since_a = (float)(characters_read - _initial_characters_read[x] - a_len * (a - 1));
+    float characters_since_b = (float)(characters_read - _initial_characters_read[y] - b_len * (b - 1));
+
+    float pa = characters_since_a == 0 ? 1e10f : (float)a / characters_since_a;
+    float pb = characters_since_b == 0 ? 1e10f : (float)b / characters_since_b;
+    float pab = pa * pb;
+
+    float expected = (characters_since - b_len) * pab;
+    float variation = (characters_since - b_len) * pab * (1.f - pab);
+    float stddev = std::sqrt(variation);
+
+    // this is either an atom which is as significant as it's count, or it's a newly initialized sequence
+    bool untracked = x == 0 || y == 0 || a == 0 || b == 0;
+    // or nothing could have come between its halves yet
+    bool unspaced = characters_since - b_len == 0;
+
+    expected_count = untracked ? 0.f : expected;
+    stddev_count = untracked || unspaced ? 1.f : stddev;
+    return untracked || unspaced ? count : (count - expected) / stddev;
+}
+
+void seqt_cpu::is_sequence_significant(std::vector<long2_> const & seq, float sigma, long min_count, std::vector<long> & output) {
+    _pool.parallel_for(seq.size(), [&](long begin, long end) {
+        #pragma omp simd
+        for(long gid = begin; gid < end; gid++) {
+            long x = seq[gid].x;
+            long y = seq[gid].y;
+
+            // only the two halves of each candidate need their significance
+            float expected, stddev;
+            float significance0 = sequence_stats(x, _stats_characters_read, expected, stddev);
+            float significance1 = sequence_stats(y, _stats_characters_read, expected, stddev);
+
+            // & rather than &&, every test is cheap and there is no branch to vectorize around
+            output[gid] = (significance0 > sigma) & (significance1 > sigma) &
+                (_counts[x] > min_count) & (_counts[y] > min_count);
+        }
+    });
+}
+
+void seqt_cpu::calculate_stats() {
+    _expected_counts.resize(_total);
+    _stddev_counts.resize(_total);
+    _significance.resize(_total);
+
+    _pool.parallel_for(_total, [&](long begin, long end) {
+        // every row is independent, so each chunk of the pool goes through several at once
+        #pragma omp simd
+        for(long gid = begin; gid < end; gid++)
+            _significance[gid] = sequence_stats(gid, _stats_characters_read, _expected_counts[gid], _stddev_counts[gid]);
+    });
+}
+
+void seqt_cpu::gather_seqs(std::vector<long> const & index, std::vector<long> const & reverse_index, std::vector<long2_> & output) {
+    _pool.parallel_for(index.size(), [&](long begin, long end) {
+        #pragma omp simd
+        for(long gid = begin; gid < end; gid++) {
+            long i = index[gid];
+            output[gid].x = reverse_index[_seqs[i].x];
+            output[gid].y = reverse_index[_seqs[i].y];
+        }
+    });
+}
+
+void seqt_cpu::close_over_flagged(std::vector<long> & flagged) {
+    // a sequence always has a higher id than its components, so one pass in id order reaches every dependent
+    for(long i = 1; i < _total; i++) {
+        if(flagged[_seqs[i].x] || flagged[_seqs[i].y])
+            flagged[i] = 1;
+    }
+}
+
+void seqt_cpu::print_all(std::wostream & os) {
+    os << "counts: " << _counts.size() << endl;
+    std::copy(_counts.begin(), _counts.end(), std::ostream_iterator<long, wchar_t>(os, L","));
+    os << endl;
+
+    sequence_text text(_seqs, _alphabet.text());
+
+    for(long i = 0; i < _total; i++) {
+        // index 0 is the null sequence
+        std::wstring_view str = i == 0 ? L" " : text[i];
+        float sig = i < (long)_significance.size() ? _significance[i] : 0;
+        os << "\"" << str << "\": " << _counts[i] << " " << sig << "\n";
+    }
+
+    os << std::endl;
+}
+
+void seqt_cpu::save(std::string const & path) {
+    snapshot::writer w(path);
+
+    w.write_column(snapshot::counts, _counts);
+    w.write_column(snapshot::lengths, _lengths);
+    w.write_column(snapshot::seqs, _seqs);
+    w.write_column(snapshot::initial_seq_counts, _initial_seq_counts);
+    w.write_column(snapshot::initial_characters_read, _initial_characters_read);
+    w.write_column(snapshot::last_completed, _last_completed);
+    w.write_column(snapshot::expected_counts, _expected_counts);
+    w.write_column(snapshot::stddev_counts, _stddev_counts);
+    w.write_column(snapshot::significance, _significance);
+
+    snapshot::write_alphabet(w, _alphabet);
+
+    snapshot::header h;
+    h.alphabet = (uint32_t)_alphabet.get_kind();
+    h.unused = 0;
+    h.total = _total;
+    h.characters_read = _characters_read;
+    h.stats_characters_read = _stats_characters_read;
+    h.sigma = _sigma;
+    h.min_sigma = _min_sigma;
+    h.min_occurances = _min_occurances;
+    h.max_sequences_tracked = _max_sequences_tracked;
+    w.finish(h);
+}
+
+void seqt_cpu::load(std::string const & path) {
+    snapshot::reader r(path);
+    snapshot::header const & h = r.get_header();
+
+    snapshot::check_seqs(r);
+
+    auto assign = [&](snapshot::column_id id, auto & column, bool whole_table) {
+        using T = typename std::decay_t<decltype(column)>::value_type;
+
+        uint64_t rows;
+        const T * data = r.get_column<T>(id, rows);
+        if(whole_table ? rows != (uint64_t)h.total : rows > (uint64_t)h.total)
+            throw std::runtime_error(path + " column " + std::to_string(id) + " doesn't match the number of sequences");
+
+        column.assign(data, data + rows);
+    };
+
+    assign(snapshot::counts, _counts, true);
+    assign(snapshot::lengths, _lengths, true);
+    assign(snapshot::seqs, _seqs, true);
+    assign(snapshot::initial_seq_counts, _initial_seq_counts, true);
+    assign(snapshot::initial_characters_read, _initial_characters_read, true);
+    assign(snapshot::last_completed, _last_completed, true);
+    assign(snapshot::expected_counts, _expected_counts, false);
+    assign(snapshot::stddev_counts, _stddev_counts, false);
+    assign(snapshot::significance, _significance, false);
+
+    _total = h.total;
+    _characters_read = h.characters_read;
+    _stats_characters_read = h.stats_characters_read;
+    _sigma = h.sigma;
+    _min_sigma = h.min_sigma;
+    _min_occurances = h.min_occurances;
+    _max_sequences_tracked = h.max_sequences_tracked;
+
+    reserve(std::max(_total, _max_sequences_tracked));
+
+    _alphabet = snapshot::read_alphabet(r, _last_completed.data());
+
+    _pair_index.clear();
+    index_pairs(0, _total);
+
+    // the active list is rebuilt from scratch by the next character
+    _max_length = _total > 0 ? *std::max_element(_lengths.begin(), _lengths.end()) : 1;
+    _active.clear();
+    _active_since = std::numeric_limits<long>::max();
+}
+
+seqt_cpu::seqt_cpu(alphabet::kind symbols, size_t threads) :
+    _pool(threads),
+    _active_since(std::numeric_limits<long>::max()),
+    _max_length(1),
+    _total(0),
+    _characters_read(0),
+    _stats_characters_read(0),
+    _position(0),
+    _sigma(5.),
+    _min_sigma(2.),
+    _min_occurances(5),
+    _max_sequences_tracked(1e3),
+    _alphabet(symbols)
+{
+    reserve(_max_sequences_tracked);
+
+    // the null sequence
+    add_atoms(1, _characters_read);
+
+    // HACK: set the null sequence to be tracked behind any other sequence
+    // (two characters behind the first one)
+    _last_completed[0] = -2;
+
+    // the atoms of a small alphabet are made up front, they only complete once they're read
+    if(uint32_t count = _alphabet.preallocated()) {
+        long first = add_atoms(count, alphabet::not_completed);
+        for(uint32_t s = 0; s < count; s++)
+            _alphabet[s].id = first + s;
+    }
+}
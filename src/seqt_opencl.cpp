@@ -0,0 +1,2200 @@
+#include "seqt_opencl.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <algorithm>
+#include <tuple>
+#include <stdexcept>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <type_traits>
+
+#include "nth_element_struct.hpp"
+#include "kernels_source.hpp"
+#include "snapshot.hpp"
+#include "sequence_text.hpp"
+
+#include <boost/compute/function.hpp>
+
+using std::tuple;
+using std::wcout;
+using std::make_tuple;
+
+
+using namespace boost::compute;
+
+
+// number of standard deviations from the expected value ab is
+float sequence_stddevs(long a, long b, long ab) {
+    using std::sqrt;
+
+    if(ab > a || ab > b || a + b == 0)
+        return 0;
+
+    float total = (float)(a + b);
+    float pa = (float)a / total;
+    float pb = (float)b / total;
+    float pab = pa * pb;
+    float expected_value = total * pab;
+    float variation = total * pab * (1-pab);
+    float stddev = sqrt(variation);
+
+    return ((float)ab - expected_value) / stddev;
+}
+
+// the same as RADIX_BITS and RADIX_BUCKETS in cl/kernels.cl
+const int radix_bits = 4;
+const int radix_buckets = 1 << radix_bits;
+
+// how many bits it takes to write x
+int bit_width(unsigned long x) {
+    int bits = 0;
+    while(x) {
+        bits++;
+        x >>= 1;
+    }
+    return bits;
+}
+
+// the dispatch thresholds calibrated for each device so far, an engine made
+// on the same device again doesn't calibrate, see calibrate_dispatch
+std::mutex calibrated_lock;
+std::map<cl_device_id, std::map<std::string, dispatcher::primitive>> calibrated_devices;
+
+// the same for the local sizes, see tune
+std::mutex tuned_lock;
+std::map<cl_device_id, launch_tuner> tuned_devices;
+
+float sequence_pvalue(long a, long b, long ab) {
+    using std::sqrt;
+    using std::erfc;
+
+    if(a == 0 && b == 0) {
+        if(ab > 0) return 0.;
+        return 0.5;
+    }
+    float total = (float)(a + b);
+    float pa = (float)a / total;
+    float pb = (float)b / total;
+    float pab = pa * pb;
+    float expected_value = total * pab;
+    float variation = total * pab * (1-pab);
+
+    float x = ((float)ab - expected_value) * sqrt(2 / variation);
+
+    return 0.5 * erfc(x);
+}
+
+
+// struct significance_index {
+//     double significance;
+//     long index;
+
+//     bool operator==(significance_index const & r) const {
+//         return significance == r.significance && index == r.index;
+//     }
+// };
+
+// std::wostream & operator<<(std::wostream & os, significance_index const & r) {
+//     os << "{" << r.index << ":" << r.significance << "}";
+//     return os;
+// }
+
+// BOOST_COMPUTE_ADAPT_STRUCT(significance_index, significance_index, (significance, index));
+
+// BOOST_COMPUTE_FUNCTION(bool, less_significance_index, (significance_index a, significance_index b), {
+//     if(a.significance < b.significance)
+//         return true;
+//     if(a.significance > b.significance)
+//         return false;
+//     return a.index < b.index;
+// });
+
+// BOOST_COMPUTE_FUNCTION(long, index_from_significance_index, (significance_index a), {
+//     return a.index;
+// });
+
+// BOOST_COMPUTE_FUNCTION(significance_index, zip_significance_index, (float sig, long index), {
+//     significance_index r;
+//     r.significance = sig;
+//     r.index = index;
+//     return r;
+// });
+
+BOOST_COMPUTE_FUNCTION(bool, index2_compare, (index2_t a, index2_t b), {
+    if(a.x < b.x) return true;
+    if(b.x < a.x) return false;
+    if(a.y < b.y) return true;
+    return false;
+});
+
+BOOST_COMPUTE_FUNCTION(index_t, pair_second, (index2_t a), {
+    return a.y;
+});
+
+// (significance, i) as a pair of indices that sorts like the significance would,
+// NaN's last and -0 equal to 0.  the key is the bits of a float, so it fits either width
+#ifdef SEQT_INDEX32
+BOOST_COMPUTE_FUNCTION(index2_t, significance_key, (float s, index_t i), {
+    int key;
+    if(isnan(s))
+        key = INT_MAX;
+    else if(s == 0)
+        key = 0;
+    else {
+        int bits = as_int(s);
+        key = bits < 0 ? bits ^ 0x7FFFFFFF : bits;
+    }
+    return (int2)(key, i);
+});
+#else
+BOOST_COMPUTE_FUNCTION(index2_t, significance_key, (float s, index_t i), {
+    long key;
+    if(isnan(s))
+        key = LONG_MAX;
+    else if(s == 0)
+        key = 0;
+    else {
+        int bits = as_int(s);
+        key = bits < 0 ? (long)(bits ^ 0x7FFFFFFF) : (long)bits;
+    }
+    return (long2)(key, i);
+});
+#endif
+
+
+long seqt_opencl::get_char_index(uint32_t symbol) {
+    alphabet::atom & a = _alphabet[symbol];
+    if(a.seen)
+        return a.id;
+
+    if(a.id == alphabet::none) {
+        // this will mark it as completing here
+        a.id = add_atoms(1, _characters_read);
+    } else {
+        // created up front, it is tracked from its first sight like any other atom
+        fill_n(_initial_characters_read.begin() + a.id, 1, clamp_index(_characters_read), _queue);
+        fill_n(_last_completed.begin() + a.id, 1, clamp_index(_characters_read), _queue);
+    }
+
+    a.seen = true;
+    return a.id;
+}
+
+long seqt_opencl::add_atoms(long count, long last_completed) {
+    long first = _total;
+
+    // growing can rebuild the pair index from rows [0, _total), so the new
+    // rows only count once they have been filled in
+    resize_columns(first + count);
+
+    fill_n(_initial_characters_read.begin() + first, count, clamp_index(_characters_read), _queue);
+    fill_n(_lengths.begin() + first, count, 1, _queue);
+
+    // atoms have prev[i] and next[i] == 0
+    fill_n(_seqs.begin() + first, count, index2_t(0,0), _queue);
+    fill_n(_initial_seq_counts.begin() + first, count, index2_t(0,0), _queue);
+
+    fill_n(_counts.begin() + first, count, 0, _queue); // initialize count to zero because we haven't tracked this yet
+    fill_n(_last_completed.begin() + first, count, clamp_index(last_completed), _queue);
+
+    _total += count;
+    index_pairs(first, _total);
+
+    return first;
+}
+
+void seqt_opencl::read(wchar_t c) {
+    read(&c, 1);
+}
+
+void seqt_opencl::read(std::wstring_view data) {
+    read(data.data(), data.size());
+}
+
+template<typename Symbol>
+void seqt_opencl::read_symbols(const Symbol * data, size_t length) {
+    // _sigma and _min_occurances may have changed since the program was specialized
+    select_program();
+
+    // positions, counts and lengths are all at most the number of characters read
+    if(_characters_read > index_max - (long)length)
+        throw std::overflow_error("reading " + std::to_string(length) + " more symbols would overflow " +
+            std::to_string(8 * sizeof(index_t)) + " bit indices");
+
+    auto start = std::chrono::steady_clock::now();
+
+    if(_device_loop) {
+        // the device loop takes as many characters at a time as it can, what
+        // it can't do is done by read_char
+        for(size_t i = 0; i < length; )
+            i += read_on_device(data + i, length - i);
+    } else {
+        // every character is enqueued on the in-order _queue without waiting on
+        // the kernels, the only host round trips inside the block are the ones
+        // needed to size the next allocation
+        for(size_t i = 0; i < length; i++) 
+            read_char(data[i]);
+    }
+
+    // block boundary: wait for the device to catch up before handing
+    // control back to the caller
+    // bring the significance of the whole table up to date once per block
+    _stats_characters_read = _characters_read;
+    {
+        profiler::stage stage(_profiler.get(), "stats");
+        calculate_stats();
+    }
+
+    {
+        stall_timer stalled(*this, "finish");
+        finish();
+    }
+
+    if(_profiler) {
+        _profiler->collect();
+        _profiler->host("read", std::chrono::steady_clock::now() - start);
+    }
+}
+
+void seqt_opencl::read(const wchar_t * data, size_t length) {
+    read_symbols(data, length);
+}
+
+void seqt_opencl::read(const unsigned char * data, size_t length) {
+    read_symbols(data, length);
+}
+
+void seqt_opencl::read(const uint32_t * data, size_t length) {
+    read_symbols(data, length);
+}
+
+template<typename Symbol>
+size_t seqt_opencl::read_on_device(const Symbol * symbols, size_t length) {
+    // the loop state is kept in ints
+    const long int_max = std::numeric_limits<int>::max();
+    if(_characters_read + (long)length >= int_max || std::max(_total, _max_sequences_tracked) >= int_max) {
+        read_char(symbols[0]);
+        return 1;
+    }
+
+    // only atoms that are already in the table, a new one is added by read_char
+    std::vector<long> atoms;
+    for(size_t i = 0; i < length && (long)i < _device_loop_batch; i++) {
+        alphabet::atom & a = _alphabet[symbols[i]];
+        if(!a.seen)
+            break;
+        atoms.push_back(a.id);
+    }
+
+    if(atoms.empty()) {
+        read_char(symbols[0]);
+        return 1;
+    }
+
+    scratch_arena::frame frame(_arena);
+
+    // nothing can be allocated once the batch is enqueued, so everything is as big as it can get.
+    // new sequences are passed over once the table holds _max_sequences_tracked
+    reserve(std::max(_total, _max_sequences_tracked));
+    _active.reserve(_capacity, _queue);
+
+    long capacity = _capacity;
+    long found_capacity = _device_loop_found;
+    long passed_capacity = _device_loop_passed;
+    long judge_capacity = found_capacity + passed_capacity;
+
+    // new sequences get their ids from a radix sort of their packed pairs, see loop_judge
+    int id_bits = bit_width(capacity);
+    if(2 * id_bits > 64) {
+        read_char(symbols[0]);
+        return 1;
+    }
+
+    vector<int> & state = _arena.get<int>(loop::size);
+    vector<index_t> & current_flag = _arena.get<index_t>(capacity);
+    vector<index_t> * frontiers[2] = { &_arena.get<index_t>(capacity), &_arena.get<index_t>(capacity) };
+    vector<index2_t> & found = _arena.get<index2_t>(found_capacity);
+    vector<index_t> & existing = _arena.get<index_t>(found_capacity);
+    vector<index2_t> & new_finds = _arena.get<index2_t>(judge_capacity);
+    // no more than passed_capacity are judged at once, see loop_decide
+    vector<long> & keys = _arena.get<long>(passed_capacity);
+    vector<index2_t> & passed_over = _arena.get<index2_t>(passed_capacity);
+
+    // the frontier by length, see loop_hash_frontier.  a slot for each frontier sequence there can be
+    int slots = 1;
+    while(slots < capacity)
+        slots *= 2;
+    vector<int> & heads = _arena.get<int>(slots);
+    vector<int> & links = _arena.get<int>(capacity);
+    fill(heads.begin(), heads.end(), -1, _queue);
+
+    std::vector<int> host_state(loop::size, 0);
+    host_state[loop::total] = _total;
+    host_state[loop::max_length] = _max_length;
+    host_state[loop::active_since] = std::min(_active_since, int_max);
+    host_state[loop::active_count] = _active.size();
+    copy(host_state.begin(), host_state.end(), state.begin(), _queue);
+
+    index_t mask = _pair_capacity - 1;
+
+    _loop_flag_current_kernel.set_arg(0, state);
+    _loop_flag_current_kernel.set_arg(1, (index_t)capacity);
+    _loop_flag_current_kernel.set_arg(4, _last_completed);
+    _loop_flag_current_kernel.set_arg(5, current_flag);
+    _loop_flag_current_kernel.set_arg(6, *frontiers[0]);
+
+    _loop_rebuild_active_kernel.set_arg(0, state);
+    _loop_rebuild_active_kernel.set_arg(1, (index_t)capacity);
+    _loop_rebuild_active_kernel.set_arg(2, _last_completed);
+    _loop_rebuild_active_kernel.set_arg(3, _active);
+
+    _loop_find_candidates_kernel.set_arg(0, state);
+    _loop_find_candidates_kernel.set_arg(1, (index_t)capacity);
+    _loop_find_candidates_kernel.set_arg(3, _last_completed);
+    _loop_find_candidates_kernel.set_arg(4, _active);
+    _loop_find_candidates_kernel.set_arg(5, _lengths);
+    _loop_find_candidates_kernel.set_arg(7, found);
+    _loop_find_candidates_kernel.set_arg(8, (int)found_capacity);
+    _loop_find_candidates_kernel.set_arg(9, heads);
+    _loop_find_candidates_kernel.set_arg(10, links);
+    _loop_find_candidates_kernel.set_arg(11, slots - 1);
+
+    _loop_hash_frontier_kernel.set_arg(0, state);
+    _loop_hash_frontier_kernel.set_arg(1, (index_t)capacity);
+    _loop_hash_frontier_kernel.set_arg(2, _lengths);
+    _loop_hash_frontier_kernel.set_arg(4, heads);
+    _loop_hash_frontier_kernel.set_arg(5, links);
+    _loop_hash_frontier_kernel.set_arg(6, slots - 1);
+
+    _loop_unhash_frontier_kernel.set_arg(0, state);
+    _loop_unhash_frontier_kernel.set_arg(1, (index_t)capacity);
+    _loop_unhash_frontier_kernel.set_arg(2, _lengths);
+    _loop_unhash_frontier_kernel.set_arg(4, heads);
+    _loop_unhash_frontier_kernel.set_arg(5, slots - 1);
+
+    _loop_mark_exists_kernel.set_arg(0, state);
+    _loop_mark_exists_kernel.set_arg(1, (int)found_capacity);
+    _loop_mark_exists_kernel.set_arg(2, found);
+    _loop_mark_exists_kernel.set_arg(3, _pair_keys);
+    _loop_mark_exists_kernel.set_arg(4, _pair_ids);
+    _loop_mark_exists_kernel.set_arg(5, _pair_used);
+    _loop_mark_exists_kernel.set_arg(6, mask);
+    _loop_mark_exists_kernel.set_arg(7, new_finds);
+    _loop_mark_exists_kernel.set_arg(8, existing);
+
+    _loop_decide_kernel.set_arg(0, state);
+    _loop_decide_kernel.set_arg(1, (int)found_capacity);
+    _loop_decide_kernel.set_arg(2, (int)passed_capacity);
+    _loop_decide_kernel.set_arg(3, (index_t)_max_sequences_tracked);
+
+    _loop_move_passed_kernel.set_arg(0, state);
+    _loop_move_passed_kernel.set_arg(1, (int)judge_capacity);
+    _loop_move_passed_kernel.set_arg(2, new_finds);
+    _loop_move_passed_kernel.set_arg(3, passed_over);
+
+    _loop_judge_kernel.set_arg(0, state);
+    _loop_judge_kernel.set_arg(1, (int)passed_capacity);
+    _loop_judge_kernel.set_arg(2, new_finds);
+    _loop_judge_kernel.set_arg(4, id_bits);
+    _loop_judge_kernel.set_arg(5, passed_over);
+    _loop_judge_kernel.set_arg(6, _seqs);
+    _loop_judge_kernel.set_arg(7, _initial_seq_counts);
+    _loop_judge_kernel.set_arg(8, _counts);
+    _loop_judge_kernel.set_arg(9, _initial_characters_read);
+    _loop_judge_kernel.set_arg(10, _lengths);
+    _loop_judge_kernel.set_arg(11, _sigma);
+    _loop_judge_kernel.set_arg(12, (index_t)_min_occurances);
+
+    _loop_add_kernel.set_arg(0, state);
+    _loop_add_kernel.set_arg(1, (int)passed_capacity);
+    _loop_add_kernel.set_arg(3, id_bits);
+    _loop_add_kernel.set_arg(4, _lengths);
+    _loop_add_kernel.set_arg(5, _seqs);
+    _loop_add_kernel.set_arg(6, _initial_seq_counts);
+    _loop_add_kernel.set_arg(7, _last_completed);
+    _loop_add_kernel.set_arg(8, _counts);
+    _loop_add_kernel.set_arg(9, _initial_characters_read);
+    _loop_add_kernel.set_arg(10, _pair_keys);
+    _loop_add_kernel.set_arg(11, _pair_ids);
+    _loop_add_kernel.set_arg(12, _pair_used);
+    _loop_add_kernel.set_arg(13, mask);
+    _loop_add_kernel.set_arg(14, current_flag);
+
+    _loop_flag_existing_kernel.set_arg(0, state);
+    _loop_flag_existing_kernel.set_arg(1, (int)found_capacity);
+    _loop_flag_existing_kernel.set_arg(2, existing);
+    _loop_flag_existing_kernel.set_arg(3, current_flag);
+
+    _loop_count_current_kernel.set_arg(0, state);
+    _loop_count_current_kernel.set_arg(1, (index_t)capacity);
+    _loop_count_current_kernel.set_arg(2, current_flag);
+    _loop_count_current_kernel.set_arg(3, _counts);
+    _loop_count_current_kernel.set_arg(4, _last_completed);
+
+    {
+        profiler::stage stage(_profiler.get(), "device_loop");
+
+        for(size_t i = 0; i < atoms.size(); i++) {
+            // the device stops at the first character it can't finish, so the ones after it do nothing
+            index_t position = _characters_read + i;
+            index_t characters_read = position + 1;
+
+            _loop_begin_character_kernel.set_arg(0, state);
+            _loop_begin_character_kernel.set_arg(1, (int)i);
+            _loop_begin_character_kernel.set_arg(2, position);
+            enqueue(_loop_begin_character_kernel, 1, 1);
+
+            _loop_flag_current_kernel.set_arg(2, (index_t)atoms[i]);
+            _loop_flag_current_kernel.set_arg(3, position);
+            enqueue_loop(_loop_flag_current_kernel, capacity);
+
+            for(long pass = 0; pass < _device_loop_passes; pass++) {
+                // the frontiers take turns
+                vector<index_t> & frontier = *frontiers[pass % 2];
+                vector<index_t> & next_frontier = *frontiers[(pass + 1) % 2];
+
+                _loop_begin_pass_kernel.set_arg(0, state);
+                _loop_begin_pass_kernel.set_arg(1, position);
+                enqueue(_loop_begin_pass_kernel, 1, 1);
+
+                enqueue_loop(_loop_rebuild_active_kernel, capacity);
+
+                _loop_hash_frontier_kernel.set_arg(3, frontier);
+                enqueue_loop(_loop_hash_frontier_kernel, capacity);
+
+                _loop_find_candidates_kernel.set_arg(2, position);
+                _loop_find_candidates_kernel.set_arg(6, frontier);
+                enqueue_loop(_loop_find_candidates_kernel, capacity);
+
+                _loop_unhash_frontier_kernel.set_arg(3, frontier);
+                enqueue_loop(_loop_unhash_frontier_kernel, capacity);
+
+                enqueue_loop(_loop_mark_exists_kernel, found_capacity);
+                enqueue(_loop_decide_kernel, 1, 1);
+                enqueue_loop(_loop_move_passed_kernel, judge_capacity);
+
+                // the sort swaps keys with its scratch, so they are bound again every pass
+                _loop_judge_kernel.set_arg(3, keys);
+                enqueue_loop(_loop_judge_kernel, passed_capacity);
+                radix_sort(keys, 2 * id_bits);
+
+                _loop_add_kernel.set_arg(2, keys);
+                _loop_add_kernel.set_arg(15, next_frontier);
+                _loop_add_kernel.set_arg(16, position);
+                _loop_add_kernel.set_arg(17, characters_read);
+                enqueue_loop(_loop_add_kernel, passed_capacity);
+
+                _loop_flag_existing_kernel.set_arg(4, next_frontier);
+                enqueue_loop(_loop_flag_existing_kernel, found_capacity);
+
+                _loop_end_pass_kernel.set_arg(0, state);
+                _loop_end_pass_kernel.set_arg(1, characters_read);
+                enqueue(_loop_end_pass_kernel, 1, 1);
+            }
+
+            _loop_end_character_kernel.set_arg(0, state);
+            _loop_end_character_kernel.set_arg(1, position);
+            enqueue(_loop_end_character_kernel, 1, 1);
+
+            _loop_count_current_kernel.set_arg(5, position);
+            enqueue_loop(_loop_count_current_kernel, capacity);
+
+            // the active list of the next character
+            enqueue_loop(_loop_rebuild_active_kernel, capacity);
+        }
+    }
+
+    // the only readback of the batch
+    {
+        stall_timer stalled(*this, "device_loop");
+        copy(state.begin(), state.end(), host_state.begin(), _queue);
+    }
+
+    int halted = host_state[loop::halt];
+    size_t done = halted ? host_state[loop::halt_at] : atoms.size();
+
+    _total = host_state[loop::total];
+    resize_columns(_total);
+    _max_length = host_state[loop::max_length];
+    _active_since = host_state[loop::active_since] == int_max ? std::numeric_limits<long>::max() : host_state[loop::active_since];
+    _active.resize(host_state[loop::active_count], _queue);
+    _characters_read += done;
+
+    _fixpoint.characters += host_state[loop::characters];
+    _fixpoint.passes += host_state[loop::passes];
+    _fixpoint.frontier_total += host_state[loop::frontier_total];
+    _fixpoint.frontier_max = std::max<long>(_fixpoint.frontier_max, host_state[loop::frontier_max]);
+    _fixpoint.candidates += host_state[loop::candidates];
+
+    // enough passes for the characters seen so far, with one to spare
+    if(!halted)
+        _device_loop_passes = std::max<long>(4, host_state[loop::max_passes] + 1);
+
+    if(!halted)
+        return done;
+
+    // the host picks the character up where the device left it
+    _position = _characters_read;
+    _characters_read++;
+    _stats_characters_read = host_state[loop::stats];
+
+    current_flag.resize(_total, _queue);
+    passed_over.resize(host_state[loop::passed], _queue);
+    vector<index_t> & frontier = *frontiers[host_state[loop::pass] % 2];
+    frontier.resize(host_state[loop::frontier], _queue);
+    bool do_remove_least_significant = host_state[loop::remove];
+
+    if(halted == loop::prune) {
+        finish_char(current_flag, true);
+    } else {
+        do_remove_least_significant = converge(frontier, current_flag, passed_over, host_state[loop::judged], do_remove_least_significant);
+        finish_char(current_flag, do_remove_least_significant);
+    }
+
+    // make room so the next batch doesn't stop for the same reason
+    if(halted == loop::unfinished)
+        _device_loop_passes *= 2;
+    else if(halted == loop::overflow && host_state[loop::found] > found_capacity)
+        _device_loop_found *= 2;
+    else if(halted == loop::overflow)
+        _device_loop_passed *= 2;
+
+    return done + 1;
+}
+
+void seqt_opencl::read_char(uint32_t symbol) {
+
+    // std::wcout << "reading: " << c << endl;
+
+    // every temporary of this character goes back to the arena when we return
+    scratch_arena::frame frame(_arena);
+
+    vector<index_t> & frontier = _arena.get<index_t>();
+    // candidates that didn't become sequences, and the statistics they were judged against
+    vector<index2_t> & passed_over = _arena.get<index2_t>();
+    long passed_over_judged_at;
+
+    // sequences are as far behind as their _last_completed is from this position
+    _position = _characters_read;
+
+    // get the index of the current char
+    // this will mark it as completing here if it's new
+    long index;
+    {
+        profiler::stage stage(_profiler.get(), "atoms");
+        index = get_char_index(symbol);
+    }
+    // significance is worked out on demand from the counts as they are now, see is_sequence_significant
+    _stats_characters_read = _characters_read;
+    _characters_read++;
+    passed_over_judged_at = _stats_characters_read;
+
+    // flag our current sequences 
+    vector<index_t> & current_flag = _arena.get<index_t>(_total);
+    {
+        profiler::stage stage(_profiler.get(), "flag_current");
+        transform(_last_completed.begin(), _last_completed.end(), current_flag.begin(), _1 == _position, _queue);
+
+        // manually set the current flag to 1 for the index of
+        // the current char
+        fill_n(current_flag.begin() + index, 1, 1, _queue);
+
+        // the first frontier is everything current, after that it is only what
+        // became current on the pass before.  a candidate ending in an older
+        // current sequence was already looked at on an earlier pass
+        pack(current_flag, pack_if::equal(1), frontier);
+    }
+    _fixpoint.characters++;
+
+    bool do_remove_least_significant = converge(frontier, current_flag, passed_over, passed_over_judged_at, false);
+    finish_char(current_flag, do_remove_least_significant);
+}
+
+bool seqt_opencl::converge(vector<index_t> & frontier, vector<index_t> & current_flag, vector<index2_t> & passed_over,
+    long passed_over_judged_at, bool do_remove_least_significant)
+{
+    scratch_arena::frame frame(_arena);
+
+    vector<index_t> & scratch = _arena.get<index_t>();
+    vector<index_t> & existing_indices = _arena.get<index_t>();
+    vector<index_t> & new_find_indices = _arena.get<index_t>();
+    vector<index2_t> & found = _arena.get<index2_t>();
+    vector<index2_t> & new_finds = _arena.get<index2_t>();
+
+    while(frontier.size() > 0) {
+        _fixpoint.add_pass(frontier.size());
+
+        // create a list of pairs of potential sequences based on the length
+        {
+            profiler::stage stage(_profiler.get(), "find_nexts");
+            find_nexts_by_length(frontier, found);
+        }
+        _fixpoint.candidates += found.size();
+
+        _arena.fit(new_find_indices, 0);
+        _arena.fit(existing_indices, 0);
+
+        if(found.size() > 0) {
+            profiler::stage stage(_profiler.get(), "mark_exists");
+
+            // mark the indices in scratch for new ones with a 0, mark the found sequence for found ones
+            _arena.fit(scratch, found.size());
+            mark_exists(found, scratch);
+
+            // Collect all the new sequences and add them to our list to be tracked
+            // now we have indices to all new sequences and existing ones
+            pack(scratch, pack_if::equal(0), new_find_indices);
+
+            // without the zeros what is left are the indices directly to our found sequences
+            compact(scratch, existing_indices);
+        }
+
+        long first_new = _total;
+        long passed_over_count = passed_over.size();
+
+        // what was passed over earlier in this character still counts against the table
+        long tracked = _total + (long)new_find_indices.size() + (long)passed_over.size();
+        if(tracked > _max_sequences_tracked) {
+            do_remove_least_significant = true;
+
+            _arena.grow(passed_over, passed_over_count + new_find_indices.size());
+            gather(new_find_indices.begin(), new_find_indices.end(), found.begin(), passed_over.begin() + passed_over_count, _queue);
+        } else {
+            profiler::stage stage(_profiler.get(), "new_finds");
+
+            // adding sequences moves the statistics on, so whatever was
+            // passed over before that has to be judged again
+            bool judge_again = passed_over_judged_at != _stats_characters_read;
+            if(!judge_again)
+                passed_over_count = 0;
+            passed_over_judged_at = _stats_characters_read;
+
+            _arena.fit(new_finds, new_find_indices.size() + passed_over_count);
+
+            // gather all the new finds using the indices
+            gather(new_find_indices.begin(), new_find_indices.end(), found.begin(), new_finds.begin(), _queue);
+            if(judge_again) {
+                copy(passed_over.begin(), passed_over.end(), new_finds.begin() + new_find_indices.size(), _queue);
+                _arena.fit(passed_over, 0);
+            }
+
+            // new sequences get their ids in (prev, next) order
+            sort_pairs(new_finds);
+            process_new_finds(new_finds, current_flag, passed_over);
+        }
+
+        // the next frontier is every sequence added or flagged on this pass
+        {
+            profiler::stage stage(_profiler.get(), "flag_existing");
+            _arena.fit(frontier, _total - first_new);
+            iota(frontier.begin(), frontier.end(), first_new, _queue);
+            flag_existing(existing_indices, current_flag, frontier);
+        }
+    }
+
+    return do_remove_least_significant;
+}
+
+void seqt_opencl::finish_char(vector<index_t> & current_flag, bool do_remove_least_significant) {
+    scratch_arena::frame frame(_arena);
+
+    vector<index_t> & current = _arena.get<index_t>();
+
+    // pruning ranks the whole table, so it needs every significance from before the counts change.
+    // nothing but the count increments has to wait for them, so the pack below and its
+    // readback go ahead while they are worked out on the side
+    wait_list stats_done;
+    if(do_remove_least_significant) {
+        profiler::stage stage(_profiler.get(), "prune");
+        stats_done.insert(calculate_stats(side_queue()));
+    }
+
+    {
+        profiler::stage stage(_profiler.get(), "counts");
+        pack(current_flag, pack_if::equal(1), current);
+
+        // increment the counts of all the flagged sequences
+        // and mark them as completing at this position
+        increment_counts(current, stats_done);
+    }
+
+    {
+        profiler::stage stage(_profiler.get(), "active");
+        update_active(current, current_flag);
+    }
+
+    if(do_remove_least_significant) {
+        profiler::stage stage(_profiler.get(), "prune");
+        remove_least_significant(_total / 2);
+    }
+}
+
+long seqt_opencl::process_new_finds(vector<index2_t> & finds, vector<index_t> & current_flag, vector<index2_t> & passed_over) {
+    if(finds.size() == 0)
+        return 0;
+
+    scratch_arena::frame frame(_arena);
+
+    vector<index_t> & scratch = _arena.get<index_t>(finds.size());
+    // filter the new sequences by significance
+    // transform(_significance.begin(), _significance.end(), scratch2.begin(), scratch2.begin(), _2 == 0 && _1 > 5., _queue);
+    is_sequence_significant(finds, _sigma, _min_occurances, scratch);
+
+    // the ones that aren't significant are kept in case the statistics change
+    vector<index_t> & passed_indices = _arena.get<index_t>();
+    pack(scratch, pack_if::equal(0), passed_indices);
+
+    long passed_over_count = passed_over.size();
+    _arena.grow(passed_over, passed_over_count + passed_indices.size());
+    gather(passed_indices.begin(), passed_indices.end(), finds.begin(), passed_over.begin() + passed_over_count, _queue);
+
+    // is it both significant and new?
+    long new_count = finds.size() - passed_indices.size();
+
+    // std::wcout << "new_count after: " << new_count << endl;
+
+    if(new_count > 0) {
+        vector<index_t> & new_find_indices = _arena.get<index_t>();
+        pack(scratch, pack_if::equal(1), new_find_indices);
+
+        add_new_finds(new_find_indices, finds, _position);
+        _stats_characters_read = _characters_read;
+        
+        long original_size = current_flag.size();
+        _arena.grow(current_flag, _total);
+
+        // all new sequences are flaged as current
+        fill(current_flag.begin() + original_size, current_flag.end(), 1, _queue); 
+    }
+
+    return new_count;
+}
+
+long seqt_opencl::flag_existing(vector<index_t> & existing_indices, vector<index_t> & current_flag, vector<index_t> & newly_flagged) {
+    if(existing_indices.size() == 0)
+        return 0;
+
+    scratch_arena::frame frame(_arena);
+
+    vector<index_t> & scratch = _arena.get<index_t>(existing_indices.size());
+
+    // re-use scratch to see which of these existing sequences haven't been flagged yet
+    gather(existing_indices.begin(), existing_indices.end(), current_flag.begin(), scratch.begin(), _queue);
+
+    vector<index_t> & unflagged = _arena.get<index_t>();
+    pack(scratch, pack_if::equal(0), unflagged);
+
+    long count = unflagged.size();
+    if(count > 0) {
+        long original_size = newly_flagged.size();
+        _arena.grow(newly_flagged, original_size + count);
+
+        buffer_iterator<index_t> flagged_begin = newly_flagged.begin() + original_size;
+        gather(unflagged.begin(), unflagged.end(), existing_indices.begin(), flagged_begin, _queue);
+        fill(scratch.begin(), scratch.begin() + count, 1, _queue);
+        scatter(scratch.begin(), scratch.begin() + count, flagged_begin, current_flag.begin(), _queue);
+    }
+
+    return count;
+}
+
+void seqt_opencl::rebuild_active(long since) {
+    // since is numeric_limits<long>::max() when nothing is active yet
+    pack(_last_completed, pack_if::at_least(clamp_index(since)), _active);
+    _active_since = since;
+}
+
+void seqt_opencl::update_active(vector<index_t> & current, vector<index_t> & current_flag) {
+    scratch_arena::frame frame(_arena);
+
+    // what the next character can reach back to
+    long since = _position + 1 - _max_length;
+    if(_active_since > since) {
+        rebuild_active(since);
+        return;
+    }
+
+    // keep what is still in reach, dropping the current ones so they aren't listed twice
+    vector<index_t> & keep = _arena.get<index_t>(_active.size());
+
+    long local_size = _tuner.local_size(_still_active_kernel, _active.size());
+    long operational_size = calc_operational_size(_active.size(), local_size);
+
+    _still_active_kernel.set_arg(0, _active);
+    _still_active_kernel.set_arg(1, (index_t)_active.size());
+    _still_active_kernel.set_arg(2, _last_completed);
+    _still_active_kernel.set_arg(3, current_flag);
+    _still_active_kernel.set_arg(4, clamp_index(since));
+    _still_active_kernel.set_arg(5, keep);
+    enqueue(_still_active_kernel, operational_size, local_size);
+
+    vector<index_t> & kept = _arena.get<index_t>();
+    pack(keep, pack_if::equal(1), kept);
+
+    // then add everything that completed on this character
+    _arena.fit(_active_next, kept.size() + current.size());
+    gather(kept.begin(), kept.end(), _active.begin(), _active_next.begin(), _queue);
+    copy(current.begin(), current.end(), _active_next.begin() + kept.size(), _queue);
+
+    std::swap(_active, _active_next);
+    _active_since = since;
+}
+
+long seqt_opencl::active_size() const {
+    return _active.size();
+}
+
+fixpoint_stats const & seqt_opencl::fixpoint() const {
+    return _fixpoint;
+}
+
+alphabet::kind seqt_opencl::alphabet_kind() const {
+    return _alphabet.get_kind();
+}
+
+void seqt_opencl::find_nexts_by_length(vector<index_t> & current, vector<index2_t> & found) {
+    scratch_arena::frame frame(_arena);
+
+    // STEP 1: sort all current sequences by length
+    // allocate space for the current lengths
+    vector<index_t> & current_lengths = _arena.get<index_t>(current.size());
+
+    // gather the lengths of the current items into our allocated space
+    gather(current.begin(), current.end(), _lengths.begin(), current_lengths.begin(), _queue);
+
+    // sort the current indices by the lengths
+    sort_by_length(current_lengths, current);
+
+    // only the sequences that completed within the longest length of this one can come right before a current one
+    if(_active_since > _position - _max_length)
+        rebuild_active(_position - _max_length);
+
+    // STEP 2: Find potentially new sequences by looking how far back we saw
+    //   a given sequence and marking in our sorted current lengths the possible
+    //   subsequent sequences
+    // now go through and find new sequences based on the current lengths and the tracked numbers
+    // these index the current vector which gives us the id:
+    //   current[nexts[i].s0 ... nexts[i].s1)
+    // are all the potential nexts for active sequence i
+    vector<index2_t> & nexts = _arena.get<index2_t>(_active.size());
+    vector<index_t> & next_counts = _arena.get<index_t>(_active.size());
+
+    // every active sequence can be followed by at most every current one, and the scan below counts them in indices
+    if(current.size() > 0 && (long)_active.size() > index_max / (long)current.size())
+        throw std::overflow_error("too many candidates for " + std::to_string(8 * sizeof(index_t)) + " bit indices");
+
+    find_nexts(current_lengths, nexts, next_counts);
+
+    // STEP 3: Tally up all our new potential sequences so we can enumerate them
+    // now count up how many we think we have
+    vector<index_t> & scratch = _arena.get<index_t>(_active.size());
+
+    // add them all up
+    scan(next_counts, scratch);
+    // cout << "scratch:\n";
+    // print(scratch);
+    long found_count = read_back(scratch.end() - 1);
+
+    // std::wcout << "found: " << found_count << std::endl;
+    _arena.fit(found, found_count);
+    if(found_count == 0)
+        return;
+
+    // STEP 4: Enumerate all potential new sequences and sort the list of them by (prev,next)
+    // now allocate memory to see if these are new or not
+    
+    // collect all our finds into prev and next arrays
+    collect_finds(nexts, scratch, current, found);
+}
+
+void seqt_opencl::reserve(long capacity) {
+    if(capacity <= _capacity)
+        return;
+
+    // the pair index has up to twice as many slots again, and is addressed with indices too
+    if(capacity > index_max / 2)
+        throw std::overflow_error(std::to_string(capacity) + " sequences don't fit in " +
+            std::to_string(8 * sizeof(index_t)) + " bit indices");
+
+    _counts.reserve(capacity, _queue);
+    _lengths.reserve(capacity, _queue);
+    _seqs.reserve(capacity, _queue);
+    _initial_seq_counts.reserve(capacity, _queue);
+    _initial_characters_read.reserve(capacity, _queue);
+    _last_completed.reserve(capacity, _queue);
+    _expected_counts.reserve(capacity, _queue);
+    _stddev_counts.reserve(capacity, _queue);
+    _significance.reserve(capacity, _queue);
+
+    _capacity = capacity;
+
+    // a specialized program only searches tables up to the capacity it was built for
+    select_program();
+
+    rebuild_pair_index();
+
+    // the active list is rebuilt from scratch by the next character
+    _max_length = std::max(1L, reduce_max(_lengths, 0, _total));
+    _active.resize(0, _queue);
+    _active_since = std::numeric_limits<long>::max();
+}
+
+void seqt_opencl::shrink_to_fit() {
+    _counts.shrink_to_fit(_queue);
+    _lengths.shrink_to_fit(_queue);
+    _seqs.shrink_to_fit(_queue);
+    _initial_seq_counts.shrink_to_fit(_queue);
+    _initial_characters_read.shrink_to_fit(_queue);
+    _last_completed.shrink_to_fit(_queue);
+    _expected_counts.shrink_to_fit(_queue);
+    _stddev_counts.shrink_to_fit(_queue);
+    _significance.shrink_to_fit(_queue);
+
+    _capacity = _total;
+}
+
+void seqt_opencl::resize_columns(long total) {
+    // grow geometrically so adding a sequence doesn't copy the whole table
+    if(total > _capacity)
+        reserve(std::max(total, 2 * _capacity));
+
+    _counts.resize(total, _queue);
+    _lengths.resize(total, _queue);
+    _seqs.resize(total, _queue);
+    _initial_seq_counts.resize(total, _queue);
+    _initial_characters_read.resize(total, _queue);
+    _last_completed.resize(total, _queue);
+}
+
+long seqt_opencl::add_new_finds(vector<index_t> & new_find_indices, vector<index2_t> & found, long completed_at) {
+    // std::wcout << "finds: " << found.size() << endl;
+    // grow our vectors
+    resize_columns(_total + new_find_indices.size());
+
+    fill(_initial_characters_read.begin() + _total, _initial_characters_read.begin() + _total + new_find_indices.size(), (index_t)_characters_read, _queue);
+    // initialize the new ones
+    initialize_newly_found_sequences(new_find_indices, found, completed_at);
+    index_pairs(_total, _total + new_find_indices.size());
+
+    // the active list has to reach back as far as the longest sequence
+    _max_length = std::max(_max_length, reduce_max(_lengths, _total, new_find_indices.size()));
+
+    // update our total
+    _total += new_find_indices.size();
+
+    return new_find_indices.size();
+}
+
+void seqt_opencl::least_significant_by_radix(vector<index_t> & ids) {
+    scratch_arena::frame frame(_arena);
+
+    int bits = bit_width(_total);
+    vector<long> & keys = _arena.get<long>(_total - 1);
+    significance_keys(bits, keys);
+    radix_sort(keys, 32 + bits);
+    ids_from_keys(keys, ids.size(), bits, ids);
+}
+
+void seqt_opencl::least_significant_by_selection(vector<index_t> & ids) {
+    scratch_arena::frame frame(_arena);
+
+    // key every sequence but the null sequence by (significance, index), so
+    // there are no ties and the selection matches a stable sort by significance
+    vector<index_t> & dex = _arena.get<index_t>(_total - 1);
+    vector<index2_t> & keys = _arena.get<index2_t>(_total - 1);
+    iota(dex.begin(), dex.end(), 1, _queue); // start at 1 to avoid the null sequence
+    transform(_significance.begin() + 1, _significance.begin() + _total, dex.begin(), keys.begin(), significance_key, _queue);
+
+    // the least significant only have to be found, not put in order
+    nth_element_struct(keys.begin(), keys.begin() + ids.size(), keys.end(), index2_compare, _queue);
+    transform(keys.begin(), keys.begin() + ids.size(), ids.begin(), pair_second, _queue);
+}
+
+void seqt_opencl::remove_least_significant(long max_sequences) {
+    long to_remove = _total - max_sequences;
+    if(to_remove <= 0)
+        return;
+
+    scratch_arena::frame frame(_arena);
+
+    vector<index_t> & least_significant_index = _arena.get<index_t>(to_remove);
+
+    // the significance as 32 bits that order like the float, with the index below them
+    if(32 + bit_width(_total) <= 64)
+        least_significant_by_radix(least_significant_index);
+    else
+        least_significant_by_selection(least_significant_index);
+
+    // flag all the least significant
+
+    vector<index_t> & flagged = _arena.get<index_t>(_total);
+    fill(flagged.begin(), flagged.end(), 0, _queue);
+    scatter_value(least_significant_index, 1, flagged);
+
+    // everything made from a flagged sequence has to go too
+    close_over_flagged(flagged);
+
+    vector<index_t> & keep_index = _arena.get<index_t>();
+    pack(flagged, pack_if::equal(0), keep_index);
+
+    recreate_from_map(keep_index);
+}
+
+void seqt_opencl::close_over_flagged(vector<index_t> & flagged) {
+    std::vector<index2_t> seqs(_total);
+    std::vector<index_t> host_flagged(_total);
+    {
+        stall_timer stalled(*this);
+        copy(_seqs.begin(), _seqs.begin() + _total, seqs.begin(), _queue);
+        copy(flagged.begin(), flagged.end(), host_flagged.begin(), _queue);
+    }
+
+    // a sequence always has a higher id than its components (recreate_from_map
+    // keeps the order), so one pass in id order reaches every dependent
+    for(long i = 1; i < _total; i++) {
+        if(host_flagged[seqs[i].x] || host_flagged[seqs[i].y])
+            host_flagged[i] = 1;
+    }
+
+    copy(host_flagged.begin(), host_flagged.end(), flagged.begin(), _queue);
+}
+
+void seqt_opencl::recreate_from_map(vector<index_t> & index) {
+    scratch_arena::frame frame(_arena);
+
+    // create a reverse_index
+    auto index_size = index.size();
+
+    vector<index_t> & reverse_index = _arena.get<index_t>(_total);
+    vector<index_t> & iota_vec = _arena.get<index_t>(index_size);
+    iota(iota_vec.begin(), iota_vec.end(), 0, _queue); // start with one to make room for our null sequence
+    // any data to be removed will be marked with 0
+    fill(reverse_index.begin(), reverse_index.end(), 0, _queue);
+    scatter(iota_vec.begin(), iota_vec.end(), index.begin(), reverse_index.begin(), _queue);
+
+    // now reverse_index[i] is the location of sequence `i` in our new arrays.
+    // they come from the arena and keep the capacity of the old ones, so we don't
+    // have to grow them again right away.  the old columns go back to the arena
+    // when they are swapped out, so the next prune reuses them
+    auto take = [&](auto & column) -> std::decay_t<decltype(column)> & {
+        using T = typename std::decay_t<decltype(column)>::value_type;
+        vector<T> & v = _arena.get<T>();
+        _arena.fit(v, _capacity);
+        v.resize(index_size, _queue);
+        return v;
+    };
+
+    vector<index_t> & new_counts = take(_counts);
+    vector<index_t> & new_lengths = take(_lengths);
+    vector<index2_t> & new_seqs = take(_seqs);
+    vector<index2_t> & new_initial_seq_counts = take(_initial_seq_counts);
+    vector<index_t> & new_initial_characters_read = take(_initial_characters_read);
+    vector<float> & new_expected_counts = take(_expected_counts);
+    vector<float> & new_stddev_counts = take(_stddev_counts);
+    vector<float> & new_significance = take(_significance);
+    vector<index_t> & new_last_completed = take(_last_completed);
+
+    // get the null sequence
+    // zero will always be there
+    // copy_n(_counts.begin(), 1, new_counts.begin(), _queue);
+    // copy_n(_lengths.begin(), 1, new_lengths.begin(), _queue);
+    // copy_n(_seqs.begin(), 1, new_seqs.begin(), _queue);
+    // copy_n(_initial_seq_counts.begin(), 1, new_initial_seq_counts.begin(), _queue);
+    // copy_n(_initial_characters_read.begin(), 1, new_initial_characters_read.begin(), _queue);
+    // copy_n(_expected_counts.begin(), 1, new_expected_counts.begin(), _queue);
+    // copy_n(_stddev_counts.begin(), 1, new_stddev_counts.begin(), _queue);
+    // copy_n(_significance.begin(), 1, new_significance.begin(), _queue);
+    // copy_n(_last_completed.begin(), 1, new_last_completed.begin(), _queue);
+
+    // then gather the rest
+    gather(index.begin(), index.end(), _counts.begin(), new_counts.begin(), _queue);
+    gather(index.begin(), index.end(), _lengths.begin(), new_lengths.begin(), _queue);
+    gather(index.begin(), index.end(), _initial_seq_counts.begin(), new_initial_seq_counts.begin(), _queue);
+    gather(index.begin(), index.end(), _initial_characters_read.begin(), new_initial_characters_read.begin(), _queue);
+    gather(index.begin(), index.end(), _expected_counts.begin(), new_expected_counts.begin(), _queue);
+    gather(index.begin(), index.end(), _stddev_counts.begin(), new_stddev_counts.begin(), _queue);
+    gather(index.begin(), index.end(), _significance.begin(), new_significance.begin(), _queue);
+    gather(index.begin(), index.end(), _last_completed.begin(), new_last_completed.begin(), _queue);
+
+    // carefully rewrite the seqs
+    gather_seqs(index, reverse_index, new_seqs);
+
+    // now swap them in.  assigning would copy them over on the default queue of
+    // the columns, which isn't ordered after the gathers still running on _queue
+    _counts.swap(new_counts);
+    _lengths.swap(new_lengths);
+    _seqs.swap(new_seqs);
+    _initial_seq_counts.swap(new_initial_seq_counts);
+    _initial_characters_read.swap(new_initial_characters_read);
+    _expected_counts.swap(new_expected_counts);
+    _stddev_counts.swap(new_stddev_counts);
+    _significance.swap(new_significance);
+    _last_completed.swap(new_last_completed);
+
+    // and finally shrink our total
+    _total = index_size;
+
+    // every id has moved
+    rebuild_pair_index();
+    rebuild_active(_active_since);
+
+    // and the atoms
+    std::vector<index_t> cpu_reverse_index(reverse_index.size());
+    copy(reverse_index.begin(), reverse_index.end(), cpu_reverse_index.begin(), _queue);
+    _alphabet.remap(std::vector<long>(cpu_reverse_index.begin(), cpu_reverse_index.end()));
+}
+
+
+event seqt_opencl::scatter_value(vector<index_t> & indices, long value, vector<index_t> & output, const wait_list & events) {
+    long local_size = _tuner.local_size(_scatter_value_kernel, indices.size());
+    long operational_size = calc_operational_size(indices.size(), local_size);
+
+    _scatter_value_kernel.set_arg(0, indices);
+    _scatter_value_kernel.set_arg(1, (index_t)indices.size());
+    _scatter_value_kernel.set_arg(2, (index_t)value);
+    _scatter_value_kernel.set_arg(3, output);
+
+    return enqueue(_scatter_value_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::increment_counts(vector<index_t> & current, const wait_list & events) {
+    long local_size = _tuner.local_size(_increment_counts_kernel, current.size());
+    long operational_size = calc_operational_size(current.size(), local_size);
+
+    _increment_counts_kernel.set_arg(0, current);
+    _increment_counts_kernel.set_arg(1, (index_t)current.size());
+    _increment_counts_kernel.set_arg(2, (index_t)_position);
+    _increment_counts_kernel.set_arg(3, _counts);
+    _increment_counts_kernel.set_arg(4, _last_completed);
+
+    return enqueue(_increment_counts_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::collect_finds(vector<index2_t> & nexts, vector<index_t> & scratch, vector<index_t> & current, vector<index2_t> & found, const wait_list & events) {
+    long local_size = _tuner.local_size(_collect_finds_kernel, found.size());
+    long operational_size = calc_operational_size(found.size(), local_size);
+
+    _collect_finds_kernel.set_arg(0, nexts);
+    _collect_finds_kernel.set_arg(1, scratch);
+    _collect_finds_kernel.set_arg(2, (index_t)scratch.size());
+    _collect_finds_kernel.set_arg(3, current);
+    _collect_finds_kernel.set_arg(4, _active);
+    _collect_finds_kernel.set_arg(5, found);
+    _collect_finds_kernel.set_arg(6, (index_t)found.size());
+
+    return enqueue(_collect_finds_kernel, operational_size, local_size, events);
+}
+event seqt_opencl::mark_exists(vector<index2_t> & found, vector<index_t> & scratch, const wait_list & events) {
+    long local_size = _tuner.local_size(_mark_exists_kernel, found.size());
+    long operational_size = calc_operational_size(found.size(), local_size);
+
+    _mark_exists_kernel.set_arg(0, found);
+    _mark_exists_kernel.set_arg(1, (index_t)found.size());
+    _mark_exists_kernel.set_arg(2, _pair_keys);
+    _mark_exists_kernel.set_arg(3, _pair_ids);
+    _mark_exists_kernel.set_arg(4, _pair_used);
+    _mark_exists_kernel.set_arg(5, (index_t)(_pair_capacity - 1));
+    _mark_exists_kernel.set_arg(6, scratch);
+
+    return enqueue(_mark_exists_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::index_pairs(long first, long last, const wait_list & events) {
+    if(last <= first)
+        return event();
+
+    long local_size = _tuner.local_size(_index_pairs_kernel, last - first);
+    long operational_size = calc_operational_size(last - first, local_size);
+
+    _index_pairs_kernel.set_arg(0, _seqs);
+    _index_pairs_kernel.set_arg(1, (index_t)first);
+    _index_pairs_kernel.set_arg(2, (index_t)last);
+    _index_pairs_kernel.set_arg(3, _pair_keys);
+    _index_pairs_kernel.set_arg(4, _pair_ids);
+    _index_pairs_kernel.set_arg(5, _pair_used);
+    _index_pairs_kernel.set_arg(6, (index_t)(_pair_capacity - 1));
+
+    return enqueue(_index_pairs_kernel, operational_size, local_size, events);
+}
+
+void seqt_opencl::rebuild_pair_index() {
+    // keep the load factor at or below a half for every table size up to _capacity
+    long slots = 1;
+    while(slots < 2 * std::max(_capacity, 1L))
+        slots *= 2;
+
+    if(slots != _pair_capacity) {
+        _pair_keys = vector<index2_t>(slots, _context);
+        _pair_ids = vector<index_t>(slots, _context);
+        _pair_used = vector<int>(slots, _context);
+        _pair_capacity = slots;
+    }
+
+    fill(_pair_used.begin(), _pair_used.end(), 0, _queue);
+    index_pairs(0, _total);
+}
+
+event seqt_opencl::initialize_newly_found_sequences(vector<index_t> & new_find_indices, vector<index2_t> & found, long completed_at, const wait_list & events) {
+    long local_size = _tuner.local_size(_initialize_newly_found_sequences_kernel, new_find_indices.size());
+    long operational_size = calc_operational_size(new_find_indices.size(), local_size);
+
+    _initialize_newly_found_sequences_kernel.set_arg(0, new_find_indices);
+    _initialize_newly_found_sequences_kernel.set_arg(1, (index_t)new_find_indices.size());
+    _initialize_newly_found_sequences_kernel.set_arg(2, found);
+    _initialize_newly_found_sequences_kernel.set_arg(3, _lengths);
+    _initialize_newly_found_sequences_kernel.set_arg(4, _seqs);
+    _initialize_newly_found_sequences_kernel.set_arg(5, _initial_seq_counts);
+    _initialize_newly_found_sequences_kernel.set_arg(6, _last_completed);
+    _initialize_newly_found_sequences_kernel.set_arg(7, _counts);
+    _initialize_newly_found_sequences_kernel.set_arg(8, (index_t)completed_at);
+    _initialize_newly_found_sequences_kernel.set_arg(9, (index_t)_total);
+
+    return enqueue(_initialize_newly_found_sequences_kernel, operational_size, local_size, events);
+}
+
+
+event seqt_opencl::find_nexts(vector<index_t> & sorted_lengths, vector<index2_t> & nexts, vector<index_t> & next_counts, const wait_list & events) {
+    // calculate local and operational sizes
+    long local_size = _tuner.local_size(_find_nexts_kernel, _active.size());
+    long operational_size = calc_operational_size(_active.size(), local_size);
+
+    // set parameters
+    _find_nexts_kernel.set_arg(0, _last_completed);
+    _find_nexts_kernel.set_arg(1, _active);
+    _find_nexts_kernel.set_arg(2, (index_t)_active.size());
+    _find_nexts_kernel.set_arg(3, (index_t)_position);
+    _find_nexts_kernel.set_arg(4, sorted_lengths);
+    _find_nexts_kernel.set_arg(5, (index_t)sorted_lengths.size());
+    _find_nexts_kernel.set_arg(6, nexts);
+    _find_nexts_kernel.set_arg(7, next_counts);
+
+    // run the kernel
+    return enqueue(_find_nexts_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::is_sequence_significant(vector<index2_t> & seq, float sigma, long min_count, vector<index_t> & output, const wait_list & events) {
+    long local_size = _tuner.local_size(_is_sequence_significant_kernel, seq.size());
+    long operational_size = calc_operational_size(seq.size(), local_size);
+
+    _is_sequence_significant_kernel.set_arg(0, seq);
+    _is_sequence_significant_kernel.set_arg(1, (index_t)seq.size());
+    _is_sequence_significant_kernel.set_arg(2, _seqs);
+    _is_sequence_significant_kernel.set_arg(3, _initial_seq_counts);
+    _is_sequence_significant_kernel.set_arg(4, _counts);
+    _is_sequence_significant_kernel.set_arg(5, _initial_characters_read);
+    _is_sequence_significant_kernel.set_arg(6, _lengths);
+    _is_sequence_significant_kernel.set_arg(7, (index_t)_stats_characters_read);
+    _is_sequence_significant_kernel.set_arg(8, sigma);
+    _is_sequence_significant_kernel.set_arg(9, (index_t)min_count);
+    _is_sequence_significant_kernel.set_arg(10, output);
+
+    return enqueue(_is_sequence_significant_kernel, operational_size, local_size, events);
+}
+
+
+
+event seqt_opencl::calculate_stats(const wait_list & events) {
+    return calculate_stats(_queue, events);
+}
+
+event seqt_opencl::calculate_stats(command_queue & queue, const wait_list & events) {
+    long local_size = _tuner.local_size(_calculate_stats_kernel, _total);
+    long operational_size = calc_operational_size(_total, local_size);
+
+    // these only reallocate when the table has outgrown them
+    _expected_counts.resize(_total, _queue);
+    _stddev_counts.resize(_total, _queue);
+    _significance.resize(_total, _queue);
+
+    _calculate_stats_kernel.set_arg(0, _seqs);
+    _calculate_stats_kernel.set_arg(1, _initial_seq_counts);
+    _calculate_stats_kernel.set_arg(2, _counts);
+    _calculate_stats_kernel.set_arg(3, _initial_characters_read);
+    _calculate_stats_kernel.set_arg(4, _lengths);
+    _calculate_stats_kernel.set_arg(5, (index_t)_stats_characters_read);
+    _calculate_stats_kernel.set_arg(6, _stddev_counts);
+    _calculate_stats_kernel.set_arg(7, _expected_counts);
+    _calculate_stats_kernel.set_arg(8, _significance);
+    _calculate_stats_kernel.set_arg(9, (index_t)_total);
+
+    return enqueue(queue, _calculate_stats_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::gather_seqs(vector<index_t> & index, vector<index_t> & reverse_index, vector<index2_t> & new_seqs, const wait_list & events) {
+    long local_size = _tuner.local_size(_gather_seqs_kernel, index.size());
+    long operational_size = calc_operational_size(index.size(), local_size);
+
+    _gather_seqs_kernel.set_arg(0, index);
+    _gather_seqs_kernel.set_arg(1, (index_t)index.size());
+    _gather_seqs_kernel.set_arg(2, _seqs);
+    _gather_seqs_kernel.set_arg(3, reverse_index);
+    _gather_seqs_kernel.set_arg(4, new_seqs);
+
+    return enqueue(_gather_seqs_kernel, operational_size, local_size, events);
+}
+
+void seqt_opencl::pack(vector<index_t> & data, pack_if pred, vector<index_t> & packed) {
+    profiler::stage stage(_profiler.get(), "pack");
+
+    if(_dispatch.on_host("pack", data.size())) {
+        std::vector<index_t> host(data.size());
+        {
+            stall_timer stalled(*this);
+            copy(data.begin(), data.end(), host.begin(), _queue);
+        }
+
+        std::vector<index_t> kept;
+        for(size_t i = 0; i < host.size(); i++) {
+            if(pred(host[i]))
+                kept.push_back(i);
+        }
+
+        _arena.fit(packed, kept.size());
+        copy(kept.begin(), kept.end(), packed.begin(), _queue);
+        return;
+    }
+
+    scratch_arena::frame frame(_arena);
+
+    // allocate a scratch vector
+    vector<index_t> & scratch = _arena.get<index_t>(data.size());
+
+    // scan the predicate of the data to count and prep for packing, the
+    // predicate is evaluated as the scan reads its input
+    scan(data, scratch, false, pred.or_greater ? scan_at_least : scan_equal, pred.value);
+
+    // get the count from the predicate
+    long count = read_back(scratch.end() - 1);
+
+    // allocate space for the packed indices
+    _arena.fit(packed, count);
+
+    // calculate local and operational sizes
+    long local_size = _tuner.local_size(_pack_kernel, scratch.size());
+    long operational_size = calc_operational_size(scratch.size(), local_size);
+
+    // set parameters
+    _pack_kernel.set_arg(0, (index_t)scratch.size());
+    _pack_kernel.set_arg(1, scratch);
+    _pack_kernel.set_arg(2, packed);
+
+    // run our pack kernel
+    enqueue(_pack_kernel, operational_size, local_size);
+}
+
+void seqt_opencl::compact(vector<index_t> & data, vector<index_t> & nonzero) {
+    if(_dispatch.on_host("compact", data.size())) {
+        std::vector<index_t> host(data.size());
+        {
+            stall_timer stalled(*this);
+            copy(data.begin(), data.end(), host.begin(), _queue);
+        }
+        host.erase(std::remove(host.begin(), host.end(), 0), host.end());
+
+        _arena.fit(nonzero, host.size());
+        copy(host.begin(), host.end(), nonzero.begin(), _queue);
+        return;
+    }
+
+    scratch_arena::frame frame(_arena);
+
+    // ids are never negative, so where data is at least 1 is where it isn't 0
+    vector<index_t> & kept = _arena.get<index_t>();
+    pack(data, pack_if::at_least(1), kept);
+
+    _arena.fit(nonzero, kept.size());
+    gather(kept.begin(), kept.end(), data.begin(), nonzero.begin(), _queue);
+}
+
+void seqt_opencl::scan(vector<index_t> & input, vector<index_t> & output, bool exclusive, scan_mode mode, index_t value) {
+    long total = input.size();
+    if(total == 0)
+        return;
+
+    scratch_arena::frame frame(_arena);
+
+    // a block a work group, and what each block adds up to for the level above
+    long local_size = _tuner.local_size(_scan_blocks_kernel, total);
+    long operational_size = calc_operational_size(total, local_size);
+    long blocks = operational_size / local_size;
+    vector<index_t> & block_totals = _arena.get<index_t>(blocks);
+
+    _scan_blocks_kernel.set_arg(0, input);
+    _scan_blocks_kernel.set_arg(1, (index_t)total);
+    _scan_blocks_kernel.set_arg(2, (int)mode);
+    _scan_blocks_kernel.set_arg(3, value);
+    _scan_blocks_kernel.set_arg(4, (int)exclusive);
+    _scan_blocks_kernel.set_arg(5, output);
+    _scan_blocks_kernel.set_arg(6, block_totals);
+    _scan_blocks_kernel.set_arg(7, local_buffer<index_t>(local_size));
+    enqueue(_scan_blocks_kernel, operational_size, local_size);
+
+    if(blocks == 1)
+        return;
+
+    // the totals are few enough to scan in place, then each block gets everything before it
+    scan(block_totals, block_totals);
+
+    long add_local_size = _tuner.local_size(_scan_add_kernel, total);
+    long add_operational_size = calc_operational_size(total, add_local_size);
+
+    _scan_add_kernel.set_arg(0, output);
+    _scan_add_kernel.set_arg(1, (index_t)total);
+    _scan_add_kernel.set_arg(2, (index_t)local_size);
+    _scan_add_kernel.set_arg(3, block_totals);
+    enqueue(_scan_add_kernel, add_operational_size, add_local_size);
+}
+
+long seqt_opencl::reduce_max(vector<index_t> & data, long first, long count) {
+    if(count <= 0)
+        return 0;
+
+    scratch_arena::frame frame(_arena);
+
+    // each level leaves the largest of each block for the next, until one block is left
+    vector<index_t> * input = &data;
+    while(true) {
+        long local_size = _tuner.local_size(_max_blocks_kernel, count);
+        long operational_size = calc_operational_size(count, local_size);
+        long blocks = operational_size / local_size;
+        vector<index_t> & block_max = _arena.get<index_t>(blocks);
+
+        _max_blocks_kernel.set_arg(0, *input);
+        _max_blocks_kernel.set_arg(1, (index_t)first);
+        _max_blocks_kernel.set_arg(2, (index_t)count);
+        _max_blocks_kernel.set_arg(3, block_max);
+        _max_blocks_kernel.set_arg(4, local_buffer<index_t>(local_size));
+        enqueue(_max_blocks_kernel, operational_size, local_size);
+
+        if(blocks == 1)
+            return read_back(block_max.begin());
+
+        input = &block_max;
+        first = 0;
+        count = blocks;
+    }
+}
+
+void seqt_opencl::sort_pairs(vector<index2_t> & pairs) {
+    // every id is below _total
+    sort_pairs(pairs, bit_width(_total));
+}
+
+void seqt_opencl::sort_pairs(vector<index2_t> & pairs, int bits) {
+    profiler::stage stage(_profiler.get(), "sort");
+
+    if(_dispatch.on_host("sort_pairs", pairs.size())) {
+        std::vector<index2_t> host(pairs.size());
+        {
+            stall_timer stalled(*this);
+            copy(pairs.begin(), pairs.end(), host.begin(), _queue);
+        }
+        std::sort(host.begin(), host.end(), [](index2_t const & a, index2_t const & b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+
+        copy(host.begin(), host.end(), pairs.begin(), _queue);
+        return;
+    }
+
+    // a pair fits in twice the bit width of its ids
+    if(2 * bits > 64) {
+        sort(pairs.begin(), pairs.end(), index2_compare, _queue);
+        return;
+    }
+
+    scratch_arena::frame frame(_arena);
+
+    vector<long> & keys = _arena.get<long>(pairs.size());
+    pair_keys(pairs, bits, keys);
+    radix_sort(keys, 2 * bits);
+    pairs_from_keys(keys, bits, pairs);
+}
+
+void seqt_opencl::sort_by_length(vector<index_t> & lengths, vector<index_t> & ids) {
+    // no length is over _max_length
+    sort_by_length(lengths, ids, bit_width(_max_length));
+}
+
+void seqt_opencl::sort_by_length(vector<index_t> & lengths, vector<index_t> & ids, int length_bits) {
+    profiler::stage stage(_profiler.get(), "sort");
+
+    if(_dispatch.on_host("sort_by_length", lengths.size())) {
+        std::vector<std::pair<index_t, index_t>> host(lengths.size());
+        {
+            std::vector<index_t> host_lengths(lengths.size()), host_ids(ids.size());
+            stall_timer stalled(*this);
+            copy(lengths.begin(), lengths.end(), host_lengths.begin(), _queue);
+            copy(ids.begin(), ids.end(), host_ids.begin(), _queue);
+            for(size_t i = 0; i < host.size(); i++)
+                host[i] = { host_lengths[i], host_ids[i] };
+        }
+
+        // stable like sort_by_key
+        std::stable_sort(host.begin(), host.end(), [](auto const & a, auto const & b) { return a.first < b.first; });
+
+        std::vector<index_t> host_lengths(host.size()), host_ids(host.size());
+        for(size_t i = 0; i < host.size(); i++)
+            std::tie(host_lengths[i], host_ids[i]) = host[i];
+        copy(host_lengths.begin(), host_lengths.end(), lengths.begin(), _queue);
+        copy(host_ids.begin(), host_ids.end(), ids.begin(), _queue);
+        return;
+    }
+
+    // the position below the length keeps the sort stable
+    int bits = bit_width(lengths.size());
+    if(length_bits + bits > 64) {
+        sort_by_key(lengths.begin(), lengths.end(), ids.begin(), _queue);
+        return;
+    }
+
+    scratch_arena::frame frame(_arena);
+
+    vector<long> & keys = _arena.get<long>(lengths.size());
+    vector<index_t> & unsorted_ids = _arena.get<index_t>(ids.size());
+    copy(ids.begin(), ids.end(), unsorted_ids.begin(), _queue);
+
+    length_keys(lengths, bits, keys);
+    radix_sort(keys, length_bits + bits);
+    lengths_from_keys(keys, bits, unsorted_ids, lengths, ids);
+}
+
+void seqt_opencl::radix_sort(vector<long> & keys, int bits) {
+    long total = keys.size();
+    if(total < 2 || bits <= 0)
+        return;
+
+    scratch_arena::frame frame(_arena);
+
+    // a block of keys a work group, counted and moved with the same local size.  the
+    // scan takes 32 bytes of local memory a work item, halved where there isn't enough
+    long local_size = _tuner.local_size(_radix_count_kernel, total);
+    while(local_size > 1 && local_size * (long)sizeof(ulong4_) > (long)_device.local_memory_size())
+        local_size /= 2;
+    long operational_size = calc_operational_size(total, local_size);
+    long blocks = operational_size / local_size;
+
+    vector<index_t> & counts = _arena.get<index_t>(radix_buckets * blocks);
+    vector<index_t> & offsets = _arena.get<index_t>(radix_buckets * blocks);
+    vector<long> & sorted = _arena.get<long>(total);
+
+    // least significant digit first, each pass stable, from keys into sorted and swapped back
+    for(int shift = 0; shift < bits; shift += radix_bits) {
+        _radix_count_kernel.set_arg(0, keys);
+        _radix_count_kernel.set_arg(1, (index_t)total);
+        _radix_count_kernel.set_arg(2, shift);
+        _radix_count_kernel.set_arg(3, counts);
+        _radix_count_kernel.set_arg(4, (index_t)blocks);
+        _radix_count_kernel.set_arg(5, local_buffer<int>(radix_buckets));
+        enqueue(_radix_count_kernel, operational_size, local_size);
+
+        scan(counts, offsets, true);
+
+        _radix_scatter_kernel.set_arg(0, keys);
+        _radix_scatter_kernel.set_arg(1, (index_t)total);
+        _radix_scatter_kernel.set_arg(2, shift);
+        _radix_scatter_kernel.set_arg(3, offsets);
+        _radix_scatter_kernel.set_arg(4, (index_t)blocks);
+        _radix_scatter_kernel.set_arg(5, sorted);
+        _radix_scatter_kernel.set_arg(6, local_buffer<ulong4_>(local_size));
+        enqueue(_radix_scatter_kernel, operational_size, local_size);
+
+        keys.swap(sorted);
+    }
+}
+
+event seqt_opencl::pair_keys(vector<index2_t> & pairs, int bits, vector<long> & keys, const wait_list & events) {
+    long local_size = _tuner.local_size(_pair_keys_kernel, pairs.size());
+    long operational_size = calc_operational_size(pairs.size(), local_size);
+
+    _pair_keys_kernel.set_arg(0, pairs);
+    _pair_keys_kernel.set_arg(1, (index_t)pairs.size());
+    _pair_keys_kernel.set_arg(2, bits);
+    _pair_keys_kernel.set_arg(3, keys);
+
+    return enqueue(_pair_keys_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::pairs_from_keys(vector<long> & keys, int bits, vector<index2_t> & pairs, const wait_list & events) {
+    long local_size = _tuner.local_size(_pairs_from_keys_kernel, keys.size());
+    long operational_size = calc_operational_size(keys.size(), local_size);
+
+    _pairs_from_keys_kernel.set_arg(0, keys);
+    _pairs_from_keys_kernel.set_arg(1, (index_t)keys.size());
+    _pairs_from_keys_kernel.set_arg(2, bits);
+    _pairs_from_keys_kernel.set_arg(3, pairs);
+
+    return enqueue(_pairs_from_keys_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::length_keys(vector<index_t> & lengths, int bits, vector<long> & keys, const wait_list & events) {
+    long local_size = _tuner.local_size(_length_keys_kernel, lengths.size());
+    long operational_size = calc_operational_size(lengths.size(), local_size);
+
+    _length_keys_kernel.set_arg(0, lengths);
+    _length_keys_kernel.set_arg(1, (index_t)lengths.size());
+    _length_keys_kernel.set_arg(2, bits);
+    _length_keys_kernel.set_arg(3, keys);
+
+    return enqueue(_length_keys_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::lengths_from_keys(vector<long> & keys, int bits, vector<index_t> & ids, vector<index_t> & sorted_lengths, vector<index_t> & sorted_ids, const wait_list & events) {
+    long local_size = _tuner.local_size(_lengths_from_keys_kernel, keys.size());
+    long operational_size = calc_operational_size(keys.size(), local_size);
+
+    _lengths_from_keys_kernel.set_arg(0, keys);
+    _lengths_from_keys_kernel.set_arg(1, (index_t)keys.size());
+    _lengths_from_keys_kernel.set_arg(2, bits);
+    _lengths_from_keys_kernel.set_arg(3, ids);
+    _lengths_from_keys_kernel.set_arg(4, sorted_lengths);
+    _lengths_from_keys_kernel.set_arg(5, sorted_ids);
+
+    return enqueue(_lengths_from_keys_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::significance_keys(int bits, vector<long> & keys, const wait_list & events) {
+    long local_size = _tuner.local_size(_significance_keys_kernel, _total - 1);
+    long operational_size = calc_operational_size(_total - 1, local_size);
+
+    _significance_keys_kernel.set_arg(0, _significance);
+    _significance_keys_kernel.set_arg(1, (index_t)_total);
+    _significance_keys_kernel.set_arg(2, bits);
+    _significance_keys_kernel.set_arg(3, keys);
+
+    return enqueue(_significance_keys_kernel, operational_size, local_size, events);
+}
+
+event seqt_opencl::ids_from_keys(vector<long> & keys, long count, int bits, vector<index_t> & ids, const wait_list & events) {
+    long local_size = _tuner.local_size(_ids_from_keys_kernel, count);
+    long operational_size = calc_operational_size(count, local_size);
+
+    _ids_from_keys_kernel.set_arg(0, keys);
+    _ids_from_keys_kernel.set_arg(1, (index_t)count);
+    _ids_from_keys_kernel.set_arg(2, bits);
+    _ids_from_keys_kernel.set_arg(3, ids);
+
+    return enqueue(_ids_from_keys_kernel, operational_size, local_size, events);
+}
+
+void seqt_opencl::calibrate_dispatch() {
+    // what an engine made earlier in this process calibrated
+    {
+        std::lock_guard<std::mutex> lock(calibrated_lock);
+        for(auto const & p : calibrated_devices[_device.id()]) {
+            if(!_dispatch.calibrated(p.first.c_str()))
+                _dispatch._primitives[p.first] = p.second;
+        }
+    }
+
+    const char * primitives[] = { "pack", "compact", "sort_pairs", "sort_by_length" };
+    if(std::all_of(std::begin(primitives), std::end(primitives), [&](const char * name) { return _dispatch.calibrated(name); }))
+        return;
+
+    scratch_arena::frame frame(_arena);
+
+    vector<index_t> & data = _arena.get<index_t>();
+    vector<index_t> & ids = _arena.get<index_t>();
+    vector<index_t> & output = _arena.get<index_t>();
+    vector<index2_t> & pairs = _arena.get<index2_t>();
+
+    // about what read() hands each of them: flags, ids, and pairs and lengths in no order
+    std::mt19937 rng(1);
+    auto fill_random = [&](long size, long range) {
+        std::vector<index_t> host(size);
+        for(index_t & x : host)
+            x = rng() % range;
+        _arena.fit(data, size);
+        copy(host.begin(), host.end(), data.begin(), _queue);
+    };
+
+    auto calibrate = [&](const char * name, std::function<void(long)> setup, std::function<void(long)> run) {
+        if(!_dispatch.calibrated(name))
+            _dispatch.calibrate(name, setup, run);
+    };
+
+    calibrate("pack",
+        [&](long size) { fill_random(size, 2); },
+        [&](long) { pack(data, pack_if::equal(1), output); _queue.finish(); });
+
+    calibrate("compact",
+        [&](long size) { fill_random(size, 2); },
+        [&](long) { compact(data, output); _queue.finish(); });
+
+    // the radix sorts take a pass per digit of the ids and lengths, time them with as
+    // many as a full table of sequences up to 15 long takes instead of the few atoms so far
+    int id_bits = bit_width(std::max(_capacity, 65536L));
+    int length_bits = bit_width(15);
+
+    calibrate("sort_pairs",
+        [&](long size) {
+            std::vector<index2_t> host(size);
+            for(index2_t & p : host)
+                p = index2_t(rng() % size, rng() % size);
+            _arena.fit(pairs, size);
+            copy(host.begin(), host.end(), pairs.begin(), _queue);
+        },
+        [&](long) { sort_pairs(pairs, id_bits); _queue.finish(); });
+
+    calibrate("sort_by_length",
+        [&](long size) {
+            fill_random(size, 16);
+            _arena.fit(ids, size);
+            iota(ids.begin(), ids.end(), 0, _queue);
+        },
+        [&](long) { sort_by_length(data, ids, length_bits); _queue.finish(); });
+
+    // calibrating went through on_host, none of that was read()
+    _dispatch.clear();
+    _dispatch.save();
+
+    std::lock_guard<std::mutex> lock(calibrated_lock);
+    calibrated_devices[_device.id()] = _dispatch._primitives;
+}
+
+void seqt_opencl::tune() {
+    {
+        std::lock_guard<std::mutex> lock(tuned_lock);
+        auto tuned = tuned_devices.find(_device.id());
+        if(tuned != tuned_devices.end())
+            _tuner.merge(tuned->second);
+    }
+
+    if(_tuner.tuned())
+        return;
+
+    // text with the repeats of a real one: words from a small vocabulary, the first ones more often
+    std::mt19937 rng(1);
+    std::vector<std::wstring> words(200);
+    for(std::wstring & w : words) {
+        for(long length = 1 + rng() % 8; length > 0; length--)
+            w += (wchar_t)(L'a' + rng() % 26);
+    }
+
+    std::wstring text;
+    while(text.size() < 20000) {
+        text += words[std::min(rng() % words.size(), rng() % words.size())];
+        text += L' ';
+    }
+
+    // every launch of the sample that lands in a bucket without a size is part of a sweep
+    seqt_opencl sample(alphabet::kind::code_points, false, false);
+    sample._tuner.sweep(true);
+    sample.read(text);
+    sample._tuner.save();
+
+    _tuner.merge(sample._tuner);
+
+    std::lock_guard<std::mutex> lock(tuned_lock);
+    tuned_devices[_device.id()] = sample._tuner;
+}
+
+
+template<typename T>
+void seqt_opencl::print(std::wostream & os, vector<T> & v) {
+    std::vector<T> d(v.size());
+    copy(v.begin(), v.end(), d.begin(), _queue);
+    
+    const wchar_t delim[] = {',', '\0'};
+    std::copy(d.begin(), d.end(), ostream_iterator<T, wchar_t>(os, delim));
+    os << endl;
+}
+
+
+long seqt_opencl::read_back(buffer_iterator<index_t> position) {
+    stall_timer stalled(*this);
+
+    index_t value;
+    copy_n(position, 1, &value, _queue);
+    return value;
+}
+
+seqt_opencl::stall_timer::stall_timer(seqt_opencl & s, const char * name) :
+    _s(s),
+    _name(name),
+    _start(std::chrono::steady_clock::now())
+{ }
+
+seqt_opencl::stall_timer::~stall_timer() {
+    auto stalled = std::chrono::steady_clock::now() - _start;
+    _s._stall_time += stalled;
+    _s._stall_count++;
+
+    if(_s._profiler)
+        _s._profiler->host(_name, stalled);
+}
+
+event seqt_opencl::enqueue(kernel & k, long global_size, long local_size, const wait_list & events) {
+    return enqueue(_queue, k, global_size, local_size, events);
+}
+
+event seqt_opencl::enqueue(command_queue & queue, kernel & k, long global_size, long local_size, const wait_list & events) {
+    // a launch that is part of a sweep has the device to itself while it is timed.  one at a
+    // size the tuner didn't pick (radix_scatter follows radix_count) isn't part of one
+    bool sweeping = _tuner.sweeping(k, global_size) && local_size == _tuner.local_size(k, global_size);
+    if(sweeping) {
+        stall_timer stalled(*this, "tune");
+        finish();
+    }
+
+    // the queues aren't ordered with each other, so the side queue starts where _queue is now
+    wait_list after = events;
+    if(queue != _queue)
+        after.insert(_queue.enqueue_marker());
+
+    auto start = std::chrono::steady_clock::now();
+    event e = queue.enqueue_1d_range_kernel(k, 0, global_size, local_size, after);
+    if(_profiler)
+        _profiler->kernel(k.name(), e);
+
+    if(sweeping) {
+        {
+            stall_timer stalled(*this, "tune");
+            e.wait();
+        }
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        _tuner.measured(k, global_size, local_size, seconds.count());
+    }
+
+    return e;
+}
+
+command_queue & seqt_opencl::side_queue() {
+    return _overlap ? _side_queue : _queue;
+}
+
+void seqt_opencl::finish() {
+    _queue.finish();
+    _side_queue.finish();
+}
+
+// the loop kernels check their own bounds, and read what they need from the loop state
+event seqt_opencl::enqueue_loop(kernel & k, long global_size) {
+    long local_size = _tuner.local_size(k, global_size);
+    long operational_size = calc_operational_size(global_size, local_size);
+
+    return enqueue(k, operational_size, local_size);
+}
+
+std::string seqt_opencl::build_options() const {
+    std::string options = index_build_options;
+    if(!_specialize)
+        return options;
+
+    // exactly the float the host has, written so the compiler reads it back the same
+    char sigma[64];
+    std::snprintf(sigma, sizeof(sigma), "%af", _sigma);
+
+    // the halvings a binary search over as many elements as the table can hold takes
+    long steps = 0;
+    while(steps < 62 && (1L << steps) <= _capacity)
+        steps++;
+
+    options += std::string(" -DSEQT_SIGMA=") + sigma;
+    options += " -DSEQT_MIN_COUNT=" + std::to_string(_min_occurances);
+    options += " -DSEQT_SEARCH_STEPS=" + std::to_string(steps);
+    return options;
+}
+
+void seqt_opencl::select_program() {
+    std::string options = build_options();
+    if(_program.get() && options == _program_options)
+        return;
+
+    auto built = _programs.find(options);
+    if(built == _programs.end())
+        built = _programs.emplace(options, _kernel_cache.build(seqt_kernels_source, _context, options)).first;
+
+    _program = built->second;
+    _program_options = options;
+
+    _pack_kernel = _program.create_kernel("pack");
+    _scan_blocks_kernel = _program.create_kernel("scan_blocks");
+    _scan_add_kernel = _program.create_kernel("scan_add");
+    _max_blocks_kernel = _program.create_kernel("max_blocks");
+    _scatter_value_kernel = _program.create_kernel("scatter_value");
+    _increment_counts_kernel = _program.create_kernel("increment_counts");
+    _find_nexts_kernel = _program.create_kernel("find_nexts");
+    _collect_finds_kernel = _program.create_kernel("collect_finds");
+    _mark_exists_kernel = _program.create_kernel("mark_exists");
+    _initialize_newly_found_sequences_kernel = _program.create_kernel("initialize_newly_found_sequences");
+    _calculate_stats_kernel = _program.create_kernel("calculate_stats");
+    _is_sequence_significant_kernel = _program.create_kernel("is_sequence_significant");
+    _still_active_kernel = _program.create_kernel("still_active");
+    _gather_seqs_kernel = _program.create_kernel("gather_seqs");
+    _loop_begin_character_kernel = _program.create_kernel("loop_begin_character");
+    _loop_flag_current_kernel = _program.create_kernel("loop_flag_current");
+    _loop_begin_pass_kernel = _program.create_kernel("loop_begin_pass");
+    _loop_rebuild_active_kernel = _program.create_kernel("loop_rebuild_active");
+    _loop_hash_frontier_kernel = _program.create_kernel("loop_hash_frontier");
+    _loop_find_candidates_kernel = _program.create_kernel("loop_find_candidates");
+    _loop_unhash_frontier_kernel = _program.create_kernel("loop_unhash_frontier");
+    _loop_mark_exists_kernel = _program.create_kernel("loop_mark_exists");
+    _loop_decide_kernel = _program.create_kernel("loop_decide");
+    _loop_move_passed_kernel = _program.create_kernel("loop_move_passed");
+    _loop_judge_kernel = _program.create_kernel("loop_judge");
+    _loop_add_kernel = _program.create_kernel("loop_add");
+    _loop_flag_existing_kernel = _program.create_kernel("loop_flag_existing");
+    _loop_end_pass_kernel = _program.create_kernel("loop_end_pass");
+    _loop_end_character_kernel = _program.create_kernel("loop_end_character");
+    _loop_count_current_kernel = _program.create_kernel("loop_count_current");
+    _index_pairs_kernel = _program.create_kernel("index_pairs");
+    _radix_count_kernel = _program.create_kernel("radix_count");
+    _radix_scatter_kernel = _program.create_kernel("radix_scatter");
+    _pair_keys_kernel = _program.create_kernel("pair_keys");
+    _pairs_from_keys_kernel = _program.create_kernel("pairs_from_keys");
+    _length_keys_kernel = _program.create_kernel("length_keys");
+    _lengths_from_keys_kernel = _program.create_kernel("lengths_from_keys");
+    _significance_keys_kernel = _program.create_kernel("significance_keys");
+    _ids_from_keys_kernel = _program.create_kernel("ids_from_keys");
+
+}
+
+void seqt_opencl::specialize(bool on) {
+    _specialize = on;
+    select_program();
+}
+
+profiler::report seqt_opencl::profile() {
+    if(!_profiler)
+        return profiler::report();
+
+    return _profiler->get_report();
+}
+
+long calc_operational_size(long global_size, long local_size) {
+    if (global_size % local_size == 0) {
+        return global_size;
+    }
+    return local_size * (1 + global_size / local_size);
+}
+
+
+seqt_opencl::seqt_opencl(alphabet::kind symbols, bool profiling, bool tuning) :
+    _device(system::default_device()),
+    _context(_device),
+    _queue(_context, _device, profiling ? command_queue::enable_profiling : 0),
+    _side_queue(_context, _device, profiling ? command_queue::enable_profiling : 0),
+    _overlap(true),
+    _arena(_context, _queue),
+    _counts(0, _context),
+    _lengths(0, _context),
+    _seqs(0, _context),
+    _initial_seq_counts(0, _context),
+    _initial_characters_read(0, _context),
+    _expected_counts(0, _context),
+    _stddev_counts(0, _context),
+    _significance(0, _context),
+    _last_completed(0, _context),
+    _pair_keys(0, _context),
+    _pair_ids(0, _context),
+    _pair_used(0, _context),
+    _pair_capacity(0),
+    _active(0, _context),
+    _active_next(0, _context),
+    _active_since(std::numeric_limits<long>::max()),
+    _max_length(1),
+    _total(0),
+    _capacity(0),
+    _characters_read(0),
+    _stats_characters_read(0),
+    _position(0),
+    _device_loop(false),
+    _device_loop_batch(1024),
+    _device_loop_passes(8),
+    _device_loop_found(1 << 16),
+    _device_loop_passed(1 << 16),
+    _specialize(false),
+    _kernels_from_cache(false),
+    _stall_time(0),
+    _stall_count(0),
+    _sigma(5.),
+    _min_sigma(2.),
+    _min_occurances(5),
+    _max_sequences_tracked(1e3),
+    _alphabet(symbols)
+{
+    if(profiling)
+        _profiler = std::make_unique<profiler>(&_queue);
+
+    // compiling dominates startup, so reuse the binary from an earlier run when there is one
+    select_program();
+    _kernels_from_cache = _kernel_cache.last_was_hit();
+
+    // the local sizes tuned for these kernels on this device by earlier runs
+    _tuner = launch_tuner(_device, _kernel_cache.profile_path(seqt_kernels_source, _context, index_build_options));
+    _dispatch = dispatcher(_kernel_cache.profile_path(seqt_kernels_source, _context, index_build_options, ".dispatch"));
+    if(tuning)
+        tune();
+
+    // the table is pruned before it passes _max_sequences_tracked, so this is
+    // usually the only time the columns are allocated
+    reserve(_max_sequences_tracked);
+
+    // the null sequence
+    add_atoms(1, _characters_read);
+
+    // HACK: set the null sequence to be tracked behind any other sequence
+    // (two characters behind the first one)
+    fill_n(_last_completed.begin(), 1, -2, _queue);
+
+    // the atoms of a small alphabet are made up front, they only complete once they're read
+    if(uint32_t count = _alphabet.preallocated()) {
+        long first = add_atoms(count, alphabet::not_completed);
+        for(uint32_t s = 0; s < count; s++)
+            _alphabet[s].id = first + s;
+    }
+
+    // where small inputs stop being cheaper on the host depends on the device
+    calibrate_dispatch();
+    _stall_time = std::chrono::nanoseconds(0);
+    _stall_count = 0;
+    if(_profiler)
+        _profiler->clear();
+
+    _queue.finish();
+}
+
+// snapshots and sequence_text hold 64 bit indices whatever the width of the
+// build, so a snapshot loads into either
+long widen(index_t x) { return x; }
+long2_ widen(index2_t x) { return long2_(x.x, x.y); }
+float widen(float x) { return x; }
+
+index_t narrow(long x) { return (index_t)x; }
+index2_t narrow(long2_ x) { return index2_t((index_t)x.x, (index_t)x.y); }
+float narrow(float x) { return x; }
+
+template<typename T>
+auto widen(std::vector<T> const & v) {
+    std::vector<decltype(widen(T()))> wide(v.size());
+    std::transform(v.begin(), v.end(), wide.begin(), [](T x) { return widen(x); });
+    return wide;
+}
+
+void seqt_opencl::print_all(std::wostream & os) {
+    os << "counts: " << _counts.size() << endl;
+    print(os, _counts);
+
+    std::vector<index2_t> seqs(_total);
+    std::vector<index_t> counts(_total);
+    std::vector<float> sig(_total);
+
+    copy(_seqs.begin(), _seqs.end(), seqs.begin(), _queue);
+    copy(_counts.begin(), _counts.end(), counts.begin(), _queue);
+    copy(_significance.begin(), _significance.end(), sig.begin(), _queue);
+
+    sequence_text text(widen(seqs), _alphabet.text());
+
+    for(long i = 0; i < _total; i++) {
+        // index 0 is the null sequence
+        std::wstring_view str = i == 0 ? L" " : text[i];
+        os << "\"" << str << "\": " << counts[i] << " " << sig[i] << "\n";
+    }
+    os << std::endl;
+}
+
+void seqt_opencl::save(std::string const & path) {
+    snapshot::writer w(path);
+
+    // each column is read back whole and written as one block
+    auto write = [&](snapshot::column_id id, auto & column) {
+        std::vector<typename std::decay_t<decltype(column)>::value_type> host(column.size());
+        copy(column.begin(), column.end(), host.begin(), _queue);
+        w.write_column(id, widen(host));
+    };
+
+    write(snapshot::counts, _counts);
+    write(snapshot::lengths, _lengths);
+    write(snapshot::seqs, _seqs);
+    write(snapshot::initial_seq_counts, _initial_seq_counts);
+    write(snapshot::initial_characters_read, _initial_characters_read);
+    write(snapshot::last_completed, _last_completed);
+    write(snapshot::expected_counts, _expected_counts);
+    write(snapshot::stddev_counts, _stddev_counts);
+    write(snapshot::significance, _significance);
+
+    snapshot::write_alphabet(w, _alphabet);
+
+    snapshot::header h;
+    h.alphabet = (uint32_t)_alphabet.get_kind();
+    h.unused = 0;
+    h.total = _total;
+    h.characters_read = _characters_read;
+    h.stats_characters_read = _stats_characters_read;
+    h.sigma = _sigma;
+    h.min_sigma = _min_sigma;
+    h.min_occurances = _min_occurances;
+    h.max_sequences_tracked = _max_sequences_tracked;
+    w.finish(h);
+}
+
+void seqt_opencl::load(std::string const & path) {
+    snapshot::reader r(path);
+    snapshot::header const & h = r.get_header();
+
+    // everything in the table counts up to the characters read at most
+    if(h.characters_read > index_max || h.max_sequences_tracked > index_max)
+        throw std::overflow_error(path + " is too big for " + std::to_string(8 * sizeof(index_t)) + " bit indices");
+
+    snapshot::check_seqs(r);
+
+    // make room before _total changes, reserve() reindexes what is there now
+    reserve(std::max<long>(h.total, h.max_sequences_tracked));
+
+    // the columns go from the mapping straight into their buffers
+    auto upload = [&](snapshot::column_id id, auto & column, bool whole_table) {
+        using T = typename std::decay_t<decltype(column)>::value_type;
+        using W = decltype(widen(T()));
+
+        uint64_t rows;
+        const W * data = r.get_column<W>(id, rows);
+        if(whole_table ? rows != (uint64_t)h.total : rows > (uint64_t)h.total)
+            throw std::runtime_error(path + " column " + std::to_string(id) + " doesn't match the number of sequences");
+
+        column.resize(rows, _queue);
+        if(rows == 0)
+            return;
+
+        if constexpr(std::is_same_v<T, W>) {
+            _queue.enqueue_write_buffer(column.get_buffer(), 0, rows * sizeof(T), data);
+        } else {
+            std::vector<T> narrowed(rows);
+            std::transform(data, data + rows, narrowed.begin(), [](W x) { return narrow(x); });
+            _queue.enqueue_write_buffer(column.get_buffer(), 0, rows * sizeof(T), narrowed.data());
+        }
+    };
+
+    upload(snapshot::counts, _counts, true);
+    upload(snapshot::lengths, _lengths, true);
+    upload(snapshot::seqs, _seqs, true);
+    upload(snapshot::initial_seq_counts, _initial_seq_counts, true);
+    upload(snapshot::initial_characters_read, _initial_characters_read, true);
+    upload(snapshot::last_completed, _last_completed, true);
+    // the statistics only cover the table as of the last calculate_stats
+    upload(snapshot::expected_counts, _expected_counts, false);
+    upload(snapshot::stddev_counts, _stddev_counts, false);
+    upload(snapshot::significance, _significance, false);
+
+    _total = h.total;
+    _characters_read = h.characters_read;
+    _stats_characters_read = h.stats_characters_read;
+    _sigma = h.sigma;
+    _min_sigma = h.min_sigma;
+    _min_occurances = h.min_occurances;
+    _max_sequences_tracked = h.max_sequences_tracked;
+
+    uint64_t rows;
+    _alphabet = snapshot::read_alphabet(r, r.get_column<long>(snapshot::last_completed, rows));
+
+    rebuild_pair_index();
+
+    // the active list is rebuilt from scratch by the next character
+    _max_length = std::max(1L, reduce_max(_lengths, 0, _total));
+    _active.resize(0, _queue);
+    _active_since = std::numeric_limits<long>::max();
+}
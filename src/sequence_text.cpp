@@ -0,0 +1,57 @@
+#include "sequence_text.hpp"
+
+sequence_text::sequence_text(std::vector<long2_> const & seqs, std::map<long, std::wstring> const & atom_text) :
+    _offsets(seqs.size(), 0),
+    _lengths(seqs.size(), -1)
+{
+    // children are decoded before their parents off an explicit stack, so
+    // nothing is assumed about the order of the ids and deep sequences can't
+    // run out of call stack
+    std::vector<long> stack;
+
+    auto decoded = [&](long i) { return _lengths[i] >= 0; };
+
+    for(long root = 0; root < (long)seqs.size(); root++) {
+        if(decoded(root))
+            continue;
+
+        stack.push_back(root);
+
+        while(!stack.empty()) {
+            long i = stack.back();
+            long2_ const & s = seqs[i];
+
+            // shared children can be pushed more than once
+            if(decoded(i)) {
+                stack.pop_back();
+                continue;
+            }
+
+            if(s.x == 0 && s.y == 0) {
+                // the null sequence (0) has no text of its own
+                _offsets[i] = _chars.size();
+                auto t = atom_text.find(i);
+                if(t != atom_text.end())
+                    _chars.append(t->second);
+                _lengths[i] = _chars.size() - _offsets[i];
+
+                stack.pop_back();
+                continue;
+            }
+
+            if(!decoded(s.x) || !decoded(s.y)) {
+                if(!decoded(s.x)) stack.push_back(s.x);
+                if(!decoded(s.y)) stack.push_back(s.y);
+                continue;
+            }
+
+            // append a copy of both children, _chars can move so go through offsets
+            _offsets[i] = _chars.size();
+            _chars.append(_chars, _offsets[s.x], _lengths[s.x]);
+            _chars.append(_chars, _offsets[s.y], _lengths[s.y]);
+            _lengths[i] = _lengths[s.x] + _lengths[s.y];
+
+            stack.pop_back();
+        }
+    }
+}
@@ -0,0 +1,160 @@
+#include "snapshot.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace snapshot {
+
+namespace {
+
+const char magic[8] = { 'S', 'E', 'Q', 'T', 'S', 'N', 'A', 'P' };
+
+uint64_t aligned(uint64_t offset) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+writer::writer(std::string const & path) :
+    _file(path, std::ios::binary | std::ios::trunc),
+    _path(path)
+{
+    if(!_file)
+        throw std::runtime_error("can't create snapshot " + path);
+
+    // room for the header, it is filled in by finish()
+    header empty;
+    std::memset(&empty, 0, sizeof(empty));
+    _file.write(reinterpret_cast<const char *>(&empty), sizeof(empty));
+}
+
+void writer::write_column(column_id id, uint32_t element_size, uint64_t rows, const void * data) {
+    static const char padding[alignment] = { 0 };
+
+    uint64_t offset = _file.tellp();
+    _file.write(padding, aligned(offset) - offset);
+
+    column c;
+    c.id = id;
+    c.element_size = element_size;
+    c.rows = rows;
+    c.offset = aligned(offset);
+    _columns.push_back(c);
+
+    _file.write(static_cast<const char *>(data), rows * element_size);
+}
+
+void writer::finish(header h) {
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.byte_order = byte_order;
+    h.column_count = _columns.size();
+    h.directory_offset = _file.tellp();
+
+    _file.write(reinterpret_cast<const char *>(_columns.data()), _columns.size() * sizeof(column));
+
+    _file.seekp(0);
+    _file.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    _file.flush();
+
+    if(!_file)
+        throw std::runtime_error("failed writing snapshot " + _path);
+}
+
+reader::reader(std::string const & path) :
+    _file(path),
+    _path(path)
+{
+    if(_file.size() < sizeof(header))
+        throw std::runtime_error(path + " is too short to be a snapshot");
+
+    std::memcpy(&_header, _file.data(), sizeof(header));
+
+    if(std::memcmp(_header.magic, magic, sizeof(magic)) != 0)
+        throw std::runtime_error(path + " is not a snapshot");
+    if(_header.version != version)
+        throw std::runtime_error(path + " is snapshot version " + std::to_string(_header.version) +
+            ", expected " + std::to_string(version));
+    if(_header.byte_order != byte_order)
+        throw std::runtime_error(path + " was written with a different byte order");
+
+    if(_header.directory_offset > _file.size() ||
+        _header.column_count > (_file.size() - _header.directory_offset) / sizeof(column))
+        throw std::runtime_error(path + " has a truncated column directory");
+
+    _columns.resize(_header.column_count);
+    std::memcpy(_columns.data(), _file.data() + _header.directory_offset, _columns.size() * sizeof(column));
+
+    for(column const & c : _columns) {
+        if(c.offset > _header.directory_offset ||
+            (c.element_size != 0 && c.rows > (_header.directory_offset - c.offset) / c.element_size))
+            throw std::runtime_error(path + " has a column past the end of the file");
+    }
+}
+
+const void * reader::get_column(column_id id, uint32_t element_size, uint64_t & rows) const {
+    for(column const & c : _columns) {
+        if(c.id != id)
+            continue;
+
+        if(c.element_size != element_size)
+            throw std::runtime_error(_path + " column " + std::to_string(id) + " has " +
+                std::to_string(c.element_size) + " byte elements, expected " + std::to_string(element_size));
+
+        rows = c.rows;
+        return _file.data() + c.offset;
+    }
+
+    throw std::runtime_error(_path + " is missing column " + std::to_string(id));
+}
+
+void check_seqs(reader const & r) {
+    // a row is a long2_, two longs whatever the index width of the build
+    uint64_t rows;
+    const long * pairs = static_cast<const long *>(r.get_column(seqs, 2 * sizeof(long), rows));
+
+    for(uint64_t i = 0; i < rows; i++) {
+        long prev = pairs[2 * i], next = pairs[2 * i + 1];
+        bool atom = prev == 0 && next == 0;
+        if(!atom && (prev < 0 || next < 0 || (uint64_t)prev >= i || (uint64_t)next >= i))
+            throw std::runtime_error(r.path() + " has sequence " + std::to_string(i) +
+                " made of (" + std::to_string(prev) + ", " + std::to_string(next) + ")");
+    }
+}
+
+void write_alphabet(writer & w, alphabet const & a) {
+    std::vector<uint32_t> symbols;
+    std::vector<long> ids;
+    for(auto const & p : a.atoms()) {
+        symbols.push_back(p.first);
+        ids.push_back(p.second.id);
+    }
+    w.write_column(char_index_chars, symbols);
+    w.write_column(char_index_ids, ids);
+}
+
+alphabet read_alphabet(reader const & r, const long * last_completed) {
+    header const & h = r.get_header();
+    if(h.alphabet > (uint32_t)alphabet::kind::tokens)
+        throw std::runtime_error(r.path() + " has an unknown alphabet " + std::to_string(h.alphabet));
+
+    uint64_t symbol_count, id_count;
+    const uint32_t * symbols = r.get_column<uint32_t>(char_index_chars, symbol_count);
+    const long * ids = r.get_column<long>(char_index_ids, id_count);
+    if(symbol_count != id_count)
+        throw std::runtime_error(r.path() + " has a broken character index");
+
+    alphabet a((alphabet::kind)h.alphabet);
+    for(uint64_t i = 0; i < symbol_count; i++) {
+        if(ids[i] <= 0 || ids[i] >= h.total)
+            throw std::runtime_error(r.path() + " has an atom outside of the table");
+
+        alphabet::atom & atom = a[symbols[i]];
+        atom.id = ids[i];
+        atom.seen = last_completed[ids[i]] >= 0; // not_completed, or a position
+    }
+
+    return a;
+}
+
+} // namespace snapshot
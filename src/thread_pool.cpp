@@ -0,0 +1,74 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+thread_pool::thread_pool(size_t threads) :
+    _total(0),
+    _next(0),
+    _busy(0),
+    _generation(0),
+    _stop(false)
+{
+    // the calling thread always takes part, so spawn one less
+    for(size_t i = 1; i < threads; i++)
+        _threads.emplace_back([this] { work(); });
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _start.notify_all();
+
+    for(auto & t : _threads)
+        t.join();
+}
+
+void thread_pool::run(long total, std::function<void(long, long)> job) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = std::move(job);
+        _total = total;
+        _next = 0;
+        _busy = _threads.size();
+        _generation++;
+    }
+    _start.notify_all();
+
+    work_chunks();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _busy == 0; });
+    _job = nullptr;
+}
+
+void thread_pool::work_chunks() {
+    for(;;) {
+        long begin = _next.fetch_add(grain_size);
+        if(begin >= _total)
+            return;
+
+        _job(begin, std::min(begin + grain_size, _total));
+    }
+}
+
+void thread_pool::work() {
+    unsigned long seen = 0;
+
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _start.wait(lock, [&] { return _stop || _generation != seen; });
+            if(_stop)
+                return;
+            seen = _generation;
+        }
+
+        work_chunks();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(--_busy == 0)
+            _done.notify_one();
+    }
+}
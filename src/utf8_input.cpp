@@ -0,0 +1,134 @@
+#include "utf8_input.hpp"
+
+#include <cstring>
+#include <cwchar>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const wchar_t replacement = 0xFFFD;
+
+} // namespace
+
+utf8_decoder::utf8_decoder(const char * begin, const char * end) :
+    _begin(reinterpret_cast<const unsigned char *>(begin)),
+    _next(_begin),
+    _end(reinterpret_cast<const unsigned char *>(end))
+{
+    // skip a byte order mark
+    if(_end - _next >= 3 && _next[0] == 0xEF && _next[1] == 0xBB && _next[2] == 0xBF)
+        _next += 3;
+}
+
+size_t utf8_decoder::decode(wchar_t * out, size_t capacity) {
+    wchar_t * o = out;
+    wchar_t * const o_end = out + capacity;
+
+    while(o < o_end && _next < _end) {
+#if __SSE2__
+        // widen whole runs of ASCII 16 bytes at a time
+        while(o_end - o >= 16 && _end - _next >= 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_next));
+            if(_mm_movemask_epi8(bytes) != 0)
+                break;
+
+            const __m128i zero = _mm_setzero_si128();
+            __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+
+            if constexpr (sizeof(wchar_t) == 4) {
+                __m128i * dst = reinterpret_cast<__m128i *>(o);
+                _mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(lo, zero));
+                _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(lo, zero));
+                _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(hi, zero));
+                _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(hi, zero));
+            } else {
+                __m128i * dst = reinterpret_cast<__m128i *>(o);
+                _mm_storeu_si128(dst + 0, lo);
+                _mm_storeu_si128(dst + 1, hi);
+            }
+
+            o += 16;
+            _next += 16;
+        }
+#else
+        // no vector unit, but 8 bytes can still be checked for ASCII at once
+        while(o_end - o >= 8 && _end - _next >= 8) {
+            unsigned long long word;
+            std::memcpy(&word, _next, sizeof(word));
+            if(word & 0x8080808080808080ULL)
+                break;
+
+            for(int i = 0; i < 8; i++)
+                o[i] = _next[i];
+
+            o += 8;
+            _next += 8;
+        }
+#endif
+
+        if(o == o_end || _next == _end)
+            break;
+
+        if(*_next < 0x80)
+            *o++ = *_next++;
+        else
+            *o++ = decode_one();
+    }
+
+    return o - out;
+}
+
+wchar_t utf8_decoder::decode_one() {
+    unsigned char b0 = *_next;
+
+    long length;
+    unsigned long code_point;
+
+    if(b0 >= 0xC2 && b0 <= 0xDF) {
+        length = 2;
+        code_point = b0 & 0x1F;
+    } else if(b0 >= 0xE0 && b0 <= 0xEF) {
+        length = 3;
+        code_point = b0 & 0x0F;
+    } else if(b0 >= 0xF0 && b0 <= 0xF4) {
+        length = 4;
+        code_point = b0 & 0x07;
+    } else {
+        // a stray continuation byte or one that can never start a sequence
+        _next++;
+        return replacement;
+    }
+
+    // the second byte is narrowed for the lead bytes that could otherwise
+    // start an overlong encoding, a surrogate or something past U+10FFFF
+    unsigned char low = 0x80, high = 0xBF;
+    if(b0 == 0xE0) low = 0xA0;
+    else if(b0 == 0xED) high = 0x9F;
+    else if(b0 == 0xF0) low = 0x90;
+    else if(b0 == 0xF4) high = 0x8F;
+
+    long i = 1;
+    for(; i < length && _next + i < _end; i++) {
+        unsigned char b = _next[i];
+        if(i == 1 ? (b < low || b > high) : (b & 0xC0) != 0x80)
+            break;
+        code_point = (code_point << 6) | (b & 0x3F);
+    }
+
+    if(i < length) {
+        // malformed, resume at the byte that broke the sequence
+        _next += i;
+        return replacement;
+    }
+
+    _next += length;
+
+    if(code_point > (unsigned long)WCHAR_MAX)
+        return replacement;
+
+    return (wchar_t)code_point;
+}
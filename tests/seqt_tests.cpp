@@ -0,0 +1,579 @@
+// seqt_tests [case]
+//
+// runs the named case, or every case.  exits with 0 when they pass, 1 when one
+// fails and 77 (ctest's SKIP_RETURN_CODE) when one needs an OpenCL device and
+// there isn't one.  the engine cases read examples/alice.txt, or a prefix of it,
+// and compare the tables the engines leave behind through their snapshots.
+
+#include "seqt.hpp"
+#include "mapped_file.hpp"
+#include "sequence_text.hpp"
+#include "snapshot.hpp"
+#include "utf8_input.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cwchar>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef SEQT_EXAMPLES_DIR
+#define SEQT_EXAMPLES_DIR "examples"
+#endif
+
+namespace {
+
+using boost::compute::long2_;
+
+// thrown by a case that can't run here
+struct skipped : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+struct failed : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+void expect(bool condition, std::string const & what) {
+    if(!condition)
+        throw failed(what);
+}
+
+std::vector<wchar_t> alice(size_t limit = SIZE_MAX) {
+    mapped_file file(SEQT_EXAMPLES_DIR "/alice.txt");
+    utf8_decoder decoder(file.data(), file.data() + file.size());
+
+    std::vector<wchar_t> text(file.size());
+    text.resize(decoder.decode(text.data(), text.size()));
+    if(text.size() > limit)
+        text.resize(limit);
+    return text;
+}
+
+// the engine, or a skip when it is the device one and there is no device
+seqt make(seqt::backend b, alphabet::kind symbols = alphabet::kind::code_points) {
+    if(b == seqt::backend::opencl) {
+        try {
+            if(boost::compute::system::devices().empty())
+                throw skipped("no OpenCL device");
+        } catch(boost::compute::opencl_error const & e) {
+            throw skipped(std::string("no OpenCL platform: ") + e.what());
+        }
+    }
+    return seqt(b, symbols);
+}
+
+// everything a snapshot holds, read back so tables from either engine can be compared
+struct table {
+    snapshot::header header;
+    std::vector<long> counts, lengths, initial_characters_read, last_completed;
+    std::vector<long2_> seqs, initial_seq_counts;
+    std::vector<float> expected_counts, stddev_counts, significance;
+};
+
+table table_of(seqt & s) {
+    std::string path = (std::filesystem::temp_directory_path() / "seqt_tests.snapshot").string();
+    s.save(path);
+
+    table t;
+    {
+        snapshot::reader r(path);
+        t.header = r.get_header();
+
+        auto column = [&](snapshot::column_id id, auto & v) {
+            using T = typename std::decay_t<decltype(v)>::value_type;
+            uint64_t rows;
+            const T * data = r.get_column<T>(id, rows);
+            v.assign(data, data + rows);
+        };
+
+        column(snapshot::counts, t.counts);
+        column(snapshot::lengths, t.lengths);
+        column(snapshot::seqs, t.seqs);
+        column(snapshot::initial_seq_counts, t.initial_seq_counts);
+        column(snapshot::initial_characters_read, t.initial_characters_read);
+        column(snapshot::last_completed, t.last_completed);
+        column(snapshot::expected_counts, t.expected_counts);
+        column(snapshot::stddev_counts, t.stddev_counts);
+        column(snapshot::significance, t.significance);
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    return t;
+}
+
+template<typename T>
+void expect_same_column(std::vector<T> const & a, std::vector<T> const & b, const char * name,
+    std::function<bool(T const &, T const &)> same)
+{
+    expect(a.size() == b.size(), std::string(name) + ": " + std::to_string(a.size()) + " rows against " + std::to_string(b.size()));
+    for(size_t i = 0; i < a.size(); i++)
+        expect(same(a[i], b[i]), std::string(name) + " differs first at row " + std::to_string(i));
+}
+
+// the same sequences with the same counts.  the statistics are floats worked out on
+// the device or the host, OpenCL allows its sqrt and division a few ulp either way
+void expect_same(table const & a, table const & b) {
+    expect(a.header.total == b.header.total,
+        "total: " + std::to_string(a.header.total) + " against " + std::to_string(b.header.total));
+    expect(a.header.characters_read == b.header.characters_read, "characters_read");
+    expect(a.header.stats_characters_read == b.header.stats_characters_read, "stats_characters_read");
+
+    auto same_long = [](long const & x, long const & y) { return x == y; };
+    auto same_pair = [](long2_ const & x, long2_ const & y) { return x.x == y.x && x.y == y.y; };
+    auto near = [](float const & x, float const & y) {
+        if(std::isnan(x) || std::isnan(y))
+            return std::isnan(x) && std::isnan(y);
+        return std::fabs(x - y) <= 1e-4f * std::max(1.f, std::max(std::fabs(x), std::fabs(y)));
+    };
+
+    expect_same_column<long>(a.counts, b.counts, "counts", same_long);
+    expect_same_column<long>(a.lengths, b.lengths, "lengths", same_long);
+    expect_same_column<long2_>(a.seqs, b.seqs, "seqs", same_pair);
+    expect_same_column<long2_>(a.initial_seq_counts, b.initial_seq_counts, "initial_seq_counts", same_pair);
+    expect_same_column<long>(a.initial_characters_read, b.initial_characters_read, "initial_characters_read", same_long);
+    expect_same_column<long>(a.last_completed, b.last_completed, "last_completed", same_long);
+    expect_same_column<float>(a.expected_counts, b.expected_counts, "expected_counts", near);
+    expect_same_column<float>(a.stddev_counts, b.stddev_counts, "stddev_counts", near);
+    expect_same_column<float>(a.significance, b.significance, "significance", near);
+}
+
+// how a parity case reads alice.txt into the device engine
+struct parity_settings {
+    size_t characters = SIZE_MAX;
+    size_t one_at_a_time = 0;       // read a character a call before the rest in one
+    bool device_loop = false;
+    long device_loop_batch = 0;     // 0 keeps the engine's own
+    long device_loop_passes = 0;
+};
+
+// the host engine is the device one run as C++, so whatever the device engine
+// is set up to do they have to agree
+void expect_parity(parity_settings const & settings) {
+    std::vector<wchar_t> text = alice(settings.characters);
+    size_t one_at_a_time = std::min(settings.one_at_a_time, text.size());
+
+    seqt device = make(seqt::backend::opencl);
+    seqt host = make(seqt::backend::cpu);
+
+    device._opencl->_device_loop = settings.device_loop;
+    if(settings.device_loop_batch)
+        device._opencl->_device_loop_batch = settings.device_loop_batch;
+    if(settings.device_loop_passes)
+        device._opencl->_device_loop_passes = settings.device_loop_passes;
+
+    for(seqt * s : { &device, &host }) {
+        for(size_t i = 0; i < one_at_a_time; i++)
+            s->read(text[i]);
+        s->read(text.data() + one_at_a_time, text.size() - one_at_a_time);
+    }
+
+    expect_same(table_of(host), table_of(device));
+}
+
+// the device engine runs the convergence loop from the host, see device_loop_parity for the other way
+void cpu_opencl_parity() {
+    expect_parity({});
+}
+
+// the device engine with the convergence loop of whole batches run on the device
+void device_loop_parity() {
+    parity_settings settings;
+    settings.device_loop = true;
+    expect_parity(settings);
+}
+
+// short batches with few passes, so the device loop often halts and read_char finishes the character
+void device_loop_fallbacks() {
+    parity_settings settings;
+    settings.characters = 50000;
+    settings.device_loop = true;
+    settings.device_loop_batch = 7;
+    settings.device_loop_passes = 2;
+    expect_parity(settings);
+}
+
+// the dispatch thresholds are calibrated once a device, and whichever side a
+// primitive runs on the table comes out the same
+void dispatch_sides_agree() {
+    std::vector<wchar_t> text = alice(50000);
+
+    seqt first = make(seqt::backend::opencl);
+    seqt second = make(seqt::backend::opencl);
+    for(auto const & p : first._opencl->_dispatch._primitives) {
+        auto const & q = second._opencl->_dispatch._primitives;
+        expect(q.count(p.first) && q.at(p.first).threshold == p.second.threshold,
+            p.first + " was calibrated again");
+    }
+
+    seqt host = make(seqt::backend::cpu);
+    host.read(text.data(), text.size());
+    table expected = table_of(host);
+
+    first._opencl->_dispatch._force = dispatcher::side::host;
+    first.read(text.data(), text.size());
+    expect_same(expected, table_of(first));
+
+    second._opencl->_dispatch._force = dispatcher::side::device;
+    second.read(text.data(), text.size());
+    expect_same(expected, table_of(second));
+}
+
+// pruning picks the least significant sequences with a radix sort of packed keys, or
+// with nth_element_struct when they don't fit, and both have to pick the same ones
+void radix_selects_like_nth_element() {
+    std::vector<wchar_t> text = alice(50000);
+
+    seqt device = make(seqt::backend::opencl);
+    device.read(text.data(), text.size());
+    seqt_opencl & s = *device._opencl;
+
+    auto least_significant = [&](long count, bool radix) {
+        boost::compute::vector<index_t> ids(count, s._context);
+        if(radix)
+            s.least_significant_by_radix(ids);
+        else
+            s.least_significant_by_selection(ids);
+
+        std::vector<index_t> host(count);
+        boost::compute::copy(ids.begin(), ids.end(), host.begin(), s._queue);
+        std::sort(host.begin(), host.end());
+        return host;
+    };
+
+    for(long count : { 1L, 37L, s._total / 2, s._total - 1 }) {
+        expect(least_significant(count, true) == least_significant(count, false),
+            "the " + std::to_string(count) + " least significant differ");
+    }
+}
+
+// candidates are only looked for among the active sequences, which has to be every
+// sequence that completed recently enough to come right before the next character,
+// so the candidates are the ones a search of the whole table would find
+void active_list_covers_reach() {
+    std::vector<wchar_t> text = alice(5000);
+
+    seqt host(seqt::backend::cpu);
+    seqt_cpu & s = *host._cpu;
+
+    for(size_t i = 0; i < text.size(); i++) {
+        host.read(text[i]);
+
+        std::string at = " after character " + std::to_string(i);
+
+        long longest = 0;
+        for(long id = 0; id < s._total; id++)
+            longest = std::max(longest, s._lengths[id]);
+        expect(s._max_length >= longest, "_max_length is behind the longest sequence" + at);
+        expect(s._active_since <= s._characters_read - longest, "the active list doesn't reach back far enough" + at);
+
+        std::vector<long> expected;
+        for(long id = 0; id < s._total; id++) {
+            if(s._last_completed[id] >= s._active_since)
+                expected.push_back(id);
+        }
+
+        std::vector<long> active = s._active;
+        std::sort(active.begin(), active.end());
+        expect(active == expected, "the active list isn't every sequence completed since " + std::to_string(s._active_since) + at);
+    }
+
+    // and the device keeps the same list
+    seqt device = make(seqt::backend::opencl);
+    device.read(text.data(), text.size());
+    expect(device.active_size() == host.active_size(), "the device has " + std::to_string(device.active_size()) +
+        " active sequences, the host " + std::to_string(host.active_size()));
+}
+
+// the text and count of every sequence that has been counted, whatever its id
+std::multiset<std::pair<std::wstring, long>> counted_sequences(seqt_cpu & s) {
+    sequence_text text(s._seqs, s._alphabet.text());
+
+    std::multiset<std::pair<std::wstring, long>> counted;
+    for(long id = 1; id < s._total; id++) {
+        if(s._counts[id] > 0)
+            counted.emplace(std::wstring(text[id]), s._counts[id]);
+    }
+    return counted;
+}
+
+// the alphabets only change how symbols become atoms.  tokens are made on first
+// sight like code points, so the tables are the same; bytes make all of theirs
+// up front, which moves the ids but not what is found before the first prune.
+// token ids past the direct table's cap are hashed and still give the same table
+void alphabets_agree() {
+    std::vector<wchar_t> text = alice();
+
+    seqt code_points(seqt::backend::cpu, alphabet::kind::code_points);
+    code_points.read(text.data(), text.size());
+
+    seqt tokens(seqt::backend::cpu, alphabet::kind::tokens);
+    std::vector<uint32_t> token_text(text.begin(), text.end());
+    tokens.read(token_text.data(), token_text.size());
+
+    expect_same(table_of(code_points), table_of(tokens));
+
+    // ids near the top of the range are hashed instead of growing the direct table to them
+    seqt far_tokens(seqt::backend::cpu, alphabet::kind::tokens);
+    std::vector<uint32_t> far_text(text.begin(), text.end());
+    for(uint32_t & t : far_text)
+        t += 4000000000u;
+    far_tokens.read(far_text.data(), far_text.size());
+    expect_same(table_of(code_points), table_of(far_tokens));
+
+    std::vector<unsigned char> ascii;
+    for(wchar_t c : text) {
+        if(c < 128)
+            ascii.push_back(c);
+        if(ascii.size() == 500)
+            break;
+    }
+
+    seqt first_code_points(seqt::backend::cpu, alphabet::kind::code_points);
+    std::vector<wchar_t> wide(ascii.begin(), ascii.end());
+    first_code_points.read(wide.data(), wide.size());
+    expect(first_code_points._cpu->_total < first_code_points._cpu->_max_sequences_tracked - 256,
+        "the prefix is long enough to be pruned");
+
+    seqt bytes(seqt::backend::cpu, alphabet::kind::bytes);
+    bytes.read(ascii.data(), ascii.size());
+
+    auto counted = counted_sequences(*first_code_points._cpu);
+    expect(std::any_of(counted.begin(), counted.end(), [](auto const & c) { return c.first.size() > 1; }),
+        "no sequences were found in the prefix");
+    expect(counted == counted_sequences(*bytes._cpu), "bytes and code points count different sequences");
+}
+
+// the host engine makes no OpenCL objects, so it runs where there is no device at all
+void cpu_without_device() {
+    std::vector<wchar_t> text = alice();
+
+    seqt host(seqt::backend::cpu);
+    host.read(text.data(), text.size());
+
+    table t = table_of(host);
+    expect(t.header.characters_read == (long)text.size(), "characters_read");
+    expect(t.header.total > 1, "nothing was read");
+
+    // some sequence longer than a single character was found
+    long longest = 0;
+    for(long length : t.lengths)
+        longest = std::max(longest, length);
+    expect(longest > 1, "no sequences were found");
+}
+
+// the atoms of the first characters are added one read at a time, so the table
+// grows, and the pair index is rebuilt, while add_atoms is adding rows
+void pair_index_growth() {
+    parity_settings settings;
+    settings.characters = 50000;
+    settings.one_at_a_time = 2000;
+    expect_parity(settings);
+}
+
+// a loaded model has nothing active, which the engines mark with the largest
+// long.  that has to read as "nothing" in 32 bit indices too, so the device
+// picks up where it left off like the host does
+void resume_from_snapshot() {
+    std::vector<wchar_t> text = alice(50000);
+    const size_t half = text.size() / 2;
+    std::string path = (std::filesystem::temp_directory_path() / "seqt_tests.resume").string();
+
+    auto resumed = [&](seqt::backend b) {
+        {
+            seqt first = make(b);
+            first.read(text.data(), half);
+            first.save(path);
+        }
+
+        seqt second = make(b);
+        second.load(path);
+        second.read(text.data() + half, text.size() - half);
+        return table_of(second);
+    };
+
+    table device = resumed(seqt::backend::opencl);
+    table host = resumed(seqt::backend::cpu);
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+
+    expect_same(host, device);
+}
+
+// all of `bytes` through a decoder that is handed `capacity` code points at a time
+std::wstring decoded(std::string const & bytes, size_t capacity = SIZE_MAX) {
+    utf8_decoder decoder(bytes.data(), bytes.data() + bytes.size());
+
+    std::wstring text;
+    std::vector<wchar_t> block(std::min(capacity, bytes.size() + 1));
+    while(!decoder.done()) {
+        size_t n = decoder.decode(block.data(), block.size());
+        expect(n > 0, "the decoder stopped before the end of its input");
+        text.append(block.data(), n);
+    }
+    expect(decoder.bytes_consumed() == bytes.size(), "the decoder didn't consume all of its input");
+    return text;
+}
+
+// malformed input becomes one U+FFFD per maximal subpart (Unicode 3.9, table 3-8),
+// and neither the 16 byte ASCII blocks nor the capacity change what comes out
+void utf8_decoding() {
+    const wchar_t r = 0xFFFD;
+
+    auto check = [](std::string const & bytes, std::wstring const & expected, std::string const & what) {
+        expect(decoded(bytes) == expected, what + " decodes wrong");
+    };
+
+    check("\xC3\xA9\xE2\x82\xAC", L"\u00E9\u20AC", "two and three byte sequences");
+    if(WCHAR_MAX >= 0x10FFFF)
+        check("\xF0\x9F\x98\x80\xF4\x8F\xBF\xBF", std::wstring{ (wchar_t)0x1F600, (wchar_t)0x10FFFF }, "four byte sequences");
+
+    // truncated, the valid prefix is replaced once and decoding resumes at the byte that broke it
+    check("\xE2\x82" "A", std::wstring{ r, L'A' }, "a truncated three byte sequence");
+    check("\xF0\x9F\x98" "A", std::wstring{ r, L'A' }, "a truncated four byte sequence");
+    check("A\xF0\x9F\x98", std::wstring{ L'A', r }, "a sequence cut off by the end of the input");
+    check("\x80\xBF", std::wstring{ r, r }, "stray continuation bytes");
+
+    // the narrowed second byte rejects the lead on its own, the rest are strays
+    check("\xC0\xAF", std::wstring{ r, r }, "an overlong C0 lead");
+    check("\xE0\x80\xAF", std::wstring{ r, r, r }, "an overlong E0 lead");
+    check("\xF0\x80\x80\xAF", std::wstring{ r, r, r, r }, "an overlong F0 lead");
+    check("\xED\xA0\x80", std::wstring{ r, r, r }, "an ED surrogate");
+    check("\xF4\x90\x80\x80", std::wstring{ r, r, r, r }, "an F4 past U+10FFFF");
+    check("\xF5\x80", std::wstring{ r, r }, "an F5 lead");
+
+    // only a leading byte order mark is skipped
+    check("\xEF\xBB\xBF" "ab", L"ab", "a byte order mark");
+    check("a\xEF\xBB\xBF" "b", L"a\uFEFFb", "a zero width no break space");
+
+    // multi byte sequences on either side of and across a 16 byte block edge
+    for(size_t before = 13; before <= 17; before++) {
+        std::string bytes = std::string(before, 'x') + "\xE2\x82\xAC" + std::string(20, 'y');
+        std::wstring expected = std::wstring(before, L'x') + L"\u20AC" + std::wstring(20, L'y');
+        check(bytes, expected, "a sequence " + std::to_string(before) + " bytes in");
+
+        bytes = std::string(before, 'x') + "\xE2\x82" + std::string(20, 'y');
+        expected = std::wstring(before, L'x') + r + std::wstring(20, L'y');
+        check(bytes, expected, "a truncated sequence " + std::to_string(before) + " bytes in");
+    }
+
+    // a capacity smaller than the input, resumed across calls, stops in the
+    // middle of ASCII blocks and between the bytes of nothing
+    std::string mixed;
+    for(int i = 0; i < 20; i++)
+        mixed += std::string(i, 'a') + "\xC3\xA9" + std::string(17, 'b') + "\xE2\x82" + "\xED\xA0\x80" + "\xE2\x82\xAC";
+    std::wstring whole = decoded(mixed);
+    for(size_t capacity : { 1, 2, 7, 15, 16, 17, 33 })
+        expect(decoded(mixed, capacity) == whole, "decoding " + std::to_string(capacity) + " at a time differs");
+}
+
+// a snapshot whose seqs point at themselves or past the end of the table is
+// refused before any of it is uploaded, close_over_flagged relies on it
+void load_rejects_broken_seqs() {
+    std::vector<wchar_t> text = alice(5000);
+    std::string path = (std::filesystem::temp_directory_path() / "seqt_tests.broken").string();
+
+    seqt first(seqt::backend::cpu);
+    first.read(text.data(), text.size());
+    first.save(path);
+
+    // the offset of the seqs column, from the directory at the end of the file
+    snapshot::header h;
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.read(reinterpret_cast<char *>(&h), sizeof(h));
+
+    std::vector<snapshot::column> columns(h.column_count);
+    file.seekg(h.directory_offset);
+    file.read(reinterpret_cast<char *>(columns.data()), columns.size() * sizeof(snapshot::column));
+
+    auto seqs = std::find_if(columns.begin(), columns.end(), [](auto const & c) { return c.id == snapshot::seqs; });
+    expect(seqs != columns.end(), "the snapshot has no seqs column");
+
+    auto loads = [&](long row, long2_ pair) {
+        long2_ saved;
+        file.seekg(seqs->offset + row * sizeof(long2_));
+        file.read(reinterpret_cast<char *>(&saved), sizeof(saved));
+        file.seekp(seqs->offset + row * sizeof(long2_));
+        file.write(reinterpret_cast<const char *>(&pair), sizeof(pair));
+        file.flush();
+
+        bool loaded = true;
+        try {
+            seqt second(seqt::backend::cpu);
+            second.load(path);
+        } catch(std::runtime_error const &) {
+            loaded = false;
+        }
+
+        file.seekp(seqs->offset + row * sizeof(long2_));
+        file.write(reinterpret_cast<const char *>(&saved), sizeof(saved));
+        file.flush();
+        return loaded;
+    };
+
+    long last = h.total - 1;
+    expect(loads(last, long2_(1, 2)), "an untouched snapshot doesn't load");
+    expect(!loads(last, long2_(last, 1)), "a sequence made of itself loads");
+    expect(!loads(last, long2_(1, h.total)), "a sequence made of one past the table loads");
+    expect(!loads(last, long2_(-1, 1)), "a sequence made of a negative id loads");
+    expect(!loads(0, long2_(0, 1)), "a null sequence made of something loads");
+
+    file.close();
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
+
+std::map<std::string, std::function<void()>> const cases = {
+    { "cpu_opencl_parity", cpu_opencl_parity },
+    { "cpu_without_device", cpu_without_device },
+    { "device_loop_parity", device_loop_parity },
+    { "device_loop_fallbacks", device_loop_fallbacks },
+    { "pair_index_growth", pair_index_growth },
+    { "resume_from_snapshot", resume_from_snapshot },
+    { "load_rejects_broken_seqs", load_rejects_broken_seqs },
+    { "dispatch_sides_agree", dispatch_sides_agree },
+    { "radix_selects_like_nth_element", radix_selects_like_nth_element },
+    { "active_list_covers_reach", active_list_covers_reach },
+    { "alphabets_agree", alphabets_agree },
+    { "utf8_decoding", utf8_decoding },
+};
+
+} // namespace
+
+int main(int ac, char ** av) {
+    if(ac > 2 || (ac == 2 && !cases.count(av[1]))) {
+        std::cerr << "usage: seqt_tests [case], the cases are:" << std::endl;
+        for(auto const & c : cases)
+            std::cerr << "  " << c.first << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    for(auto const & c : cases) {
+        if(ac == 2 && c.first != av[1])
+            continue;
+
+        try {
+            c.second();
+            std::cerr << c.first << ": passed" << std::endl;
+        } catch(skipped const & e) {
+            std::cerr << c.first << ": skipped, " << e.what() << std::endl;
+            if(status == EXIT_SUCCESS)
+                status = 77;
+        } catch(std::exception const & e) {
+            std::cerr << c.first << ": FAILED, " << e.what() << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}